@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    This file contains the startup code for the hARPy benchmark host.
+
+    It runs HARPyAudioProcessor headless against a stub play head, drives
+    synthetic chords through it over a grid of sample rates, block sizes,
+    orders, held-note counts and Offsets values, and reports how long
+    processBlock takes. With --lanes=N the same chords go out on N channels
+    at once, with the processor in Per Channel mode. With --automate=N the
+    Rate is switched every N samples through sample-accurate parameter
+    changes, so dumps should match across block sizes.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace {
+
+//==============================================================================
+/** Play head of a host that is always playing at a fixed tempo. */
+struct BenchPlayHead : juce::AudioPlayHead {
+    juce::Optional<PositionInfo> getPosition() const override { return info; }
+
+    void prepare(double newSampleRate, double bpm) {
+        sampleRate = newSampleRate;
+        quartersPerSample = bpm / (60.0 * sampleRate);
+        samplePosition = 0;
+
+        info.setBpm(bpm);
+        info.setTimeSignature(juce::AudioPlayHead::TimeSignature{});
+        info.setIsPlaying(true);
+        update();
+    }
+
+    void advance(int numSamples) {
+        samplePosition += numSamples;
+        update();
+    }
+
+    PositionInfo info;
+
+private:
+    void update() {
+        auto ppq = double(samplePosition) * quartersPerSample;
+        info.setTimeInSamples(samplePosition);
+        info.setPpqPosition(ppq);
+        info.setPpqPositionOfLastBarStart(std::floor(ppq / 4.0) * 4.0);
+    }
+
+    double sampleRate = 44100.0;
+    double quartersPerSample = 0.0;
+    juce::int64 samplePosition = 0;
+};
+
+//==============================================================================
+/** Deterministic input: a new chord of numNotes keys every two beats, on
+    each of the first numChannels MIDI channels. */
+class ChordGenerator {
+public:
+    ChordGenerator(int numNotesToHold, int numChannelsToUse, juce::int64 chordLengthInSamples)
+        : numNotes(numNotesToHold), numChannels(numChannelsToUse), chordLength(chordLengthInSamples) {}
+
+    void fillBlock(juce::MidiBuffer& midi, juce::int64 blockStart, int numSamples) {
+        auto nextChord = (blockStart + chordLength - 1) / chordLength * chordLength;
+
+        for (; nextChord < blockStart + numSamples; nextChord += chordLength) {
+            auto offset = int(nextChord - blockStart);
+
+            for (int channel = 1; channel <= numChannels; ++channel) {
+                auto& chord = held[channel - 1];
+
+                for (int i = 0; i < chord.size; ++i) {
+                    midi.addEvent(juce::MidiMessage::noteOff(channel, chord.notes[i]), offset);
+                }
+
+                chord.size = 0;
+                auto note = 36 + rng.nextInt(24);
+                for (int i = 0; i < numNotes && note < 128; ++i) {
+                    chord.notes[chord.size++] = note;
+                    midi.addEvent(juce::MidiMessage::noteOn(channel, note, juce::uint8(40 + rng.nextInt(88))), offset);
+                    note += 1 + rng.nextInt(5);
+                }
+            }
+        }
+    }
+
+private:
+    struct Chord {
+        std::array<int, 128> notes{};
+        int size = 0;
+    };
+
+    juce::Random rng{ 0x4a52 };
+    int numNotes;
+    int numChannels;
+    juce::int64 chordLength;
+    std::array<Chord, 16> held{};
+};
+
+//==============================================================================
+struct BenchConfig {
+    double sampleRate;
+    int blockSize;
+    int order;
+    int heldNotes;
+    int offsets;
+
+    juce::String getName() const {
+        return juce::String(juce::roundToInt(sampleRate)) + "_" + juce::String(blockSize) + "_"
+            + juce::String(order) + "_" + juce::String(heldNotes) + "_" + juce::String(offsets);
+    }
+};
+
+struct BenchResult {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double worst = 0.0;
+    double budget = 0.0;
+    int numEvents = 0;
+};
+
+void setParameter(HARPyAudioProcessor& processor, Params::Index index, float value)
+{
+    auto* param = processor.apvts.getParameter(Params::getID(index));
+    param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+double getPercentile(std::vector<double>& sorted, double fraction)
+{
+    auto index = juce::jlimit(size_t(0), sorted.size() - 1, size_t(fraction * double(sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+BenchResult runBenchmark(const BenchConfig& config, double bpm, double seconds, int lanes, int automateEvery,
+                         juce::OutputStream* dump)
+{
+    HARPyAudioProcessor processor;
+    BenchPlayHead playHead;
+
+    setParameter(processor, Params::Rate, 6.f);
+    setParameter(processor, Params::Order, float(config.order));
+    setParameter(processor, Params::NoteLength, 0.5f);
+    setParameter(processor, Params::Delta, 12.f);
+    setParameter(processor, Params::Offsets, float(config.offsets));
+    setParameter(processor, Params::ChannelMode, lanes > 1 ? 1.f : 0.f);
+
+    playHead.prepare(config.sampleRate, bpm);
+    processor.setPlayHead(&playHead);
+    processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+    processor.prepareToPlay(config.sampleRate, config.blockSize);
+
+    ChordGenerator input(config.heldNotes, lanes, juce::int64(config.sampleRate * 120.0 / bpm));
+
+    constexpr int numWarmUpBlocks = 16;
+    auto numBlocks = juce::jmax(1, int(seconds * config.sampleRate / config.blockSize));
+
+    juce::AudioBuffer<float> buffer(0, config.blockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(4096);
+
+    std::vector<double> nanos;
+    nanos.reserve(size_t(numBlocks));
+
+    BenchResult result;
+    juce::int64 blockStart = 0;
+
+    for (int block = -numWarmUpBlocks; block < numBlocks; ++block) {
+        midi.clear();
+        input.fillBlock(midi, blockStart, config.blockSize);
+
+        // Rate alternates between 1/32 and 1/64, as a host's automation lane
+        // would deliver it: changes inside the block, then the final value.
+        if (automateEvery > 0) {
+            auto next = (blockStart + automateEvery - 1) / automateEvery * automateEvery;
+            for (; next < blockStart + config.blockSize; next += automateEvery) {
+                auto rate = (next / automateEvery) % 2 == 0 ? 6.f : 5.f;
+                processor.addParameterChange(int(next - blockStart), Params::Rate, rate);
+                setParameter(processor, Params::Rate, rate);
+            }
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock(buffer, midi);
+        auto end = juce::Time::getHighResolutionTicks();
+
+        if (block >= 0) {
+            nanos.push_back(juce::Time::highResolutionTicksToSeconds(end - start) * 1.0e9);
+            result.numEvents += midi.getNumEvents();
+
+            if (dump != nullptr) {
+                for (const auto metadata : midi) {
+                    *dump << juce::String(blockStart + metadata.samplePosition);
+                    for (int i = 0; i < metadata.numBytes; ++i) {
+                        *dump << " " << juce::String::toHexString(metadata.data[i]).paddedLeft('0', 2);
+                    }
+                    *dump << "\n";
+                }
+            }
+        }
+
+        blockStart += config.blockSize;
+        playHead.advance(config.blockSize);
+    }
+
+    processor.releaseResources();
+
+    for (auto ns : nanos) {
+        result.mean += ns;
+    }
+    result.mean /= double(nanos.size());
+
+    std::sort(nanos.begin(), nanos.end());
+    result.p50 = getPercentile(nanos, 0.5);
+    result.p99 = getPercentile(nanos, 0.99);
+    result.p999 = getPercentile(nanos, 0.999);
+    result.worst = nanos.back();
+    result.budget = double(config.blockSize) / config.sampleRate * 1.0e9;
+
+    return result;
+}
+
+template <typename T>
+std::vector<T> getListOption(const juce::ArgumentList& args, const juce::String& option, std::vector<T> defaults)
+{
+    if (!args.containsOption(option)) {
+        return defaults;
+    }
+
+    juce::StringArray tokens;
+    tokens.addTokens(args.getValueForOption(option), ",", "");
+
+    std::vector<T> values;
+    for (auto& token : tokens) {
+        values.push_back(T(token.getDoubleValue()));
+    }
+    return values;
+}
+
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        std::cout << "Usage: hARPyBench [--seconds=10] [--bpm=120] [--quick] [--dump=<dir>]\n"
+                     "                  [--rates=44100,48000,96000] [--blocks=32,...] [--orders=0,...]\n"
+                     "                  [--held=1,4,8,16] [--offsets=0,4,8] [--lanes=1] [--automate=<samples>]\n";
+        return 0;
+    }
+
+    auto quick = args.containsOption("--quick");
+    auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : (quick ? 2.0 : 10.0);
+    auto bpm = args.containsOption("--bpm") ? args.getValueForOption("--bpm").getDoubleValue() : 120.0;
+    auto lanes = args.containsOption("--lanes") ? juce::jlimit(1, 16, args.getValueForOption("--lanes").getIntValue()) : 1;
+    auto automateEvery = args.containsOption("--automate") ? juce::jmax(0, args.getValueForOption("--automate").getIntValue()) : 0;
+
+    std::vector<int> allOrders;
+    for (int order = 0; order < numArpeggioOrders; ++order) {
+        allOrders.push_back(order);
+    }
+
+    auto sampleRates = getListOption<double>(args, "--rates", quick ? std::vector<double>{ 48000.0 } : std::vector<double>{ 44100.0, 48000.0, 96000.0 });
+    auto blockSizes = getListOption<int>(args, "--blocks", quick ? std::vector<int>{ 32, 512 } : std::vector<int>{ 32, 64, 128, 512, 1024, 4096 });
+    auto orders = getListOption<int>(args, "--orders", quick ? std::vector<int>{ Up, Random, ChordRepeat } : allOrders);
+    auto heldNotes = getListOption<int>(args, "--held", quick ? std::vector<int>{ 4, 16 } : std::vector<int>{ 1, 4, 8, 16 });
+    auto offsets = getListOption<int>(args, "--offsets", quick ? std::vector<int>{ 0, 8 } : std::vector<int>{ 0, 4, 8 });
+
+    juce::File dumpDir;
+    if (args.containsOption("--dump")) {
+        dumpDir = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--dump"));
+        dumpDir.createDirectory();
+    }
+
+    std::cout << "rate   block order held offs   events    mean ns     p50 ns     p99 ns   p99.9 ns   worst ns  worst/budget\n";
+
+    for (auto sampleRate : sampleRates) {
+        for (auto blockSize : blockSizes) {
+            for (auto order : orders) {
+                for (auto held : heldNotes) {
+                    for (auto offset : offsets) {
+                        BenchConfig config{ sampleRate, blockSize, order, held, offset };
+
+                        std::unique_ptr<juce::FileOutputStream> dump;
+                        if (dumpDir.isDirectory()) {
+                            auto file = dumpDir.getChildFile(config.getName() + ".txt");
+                            file.deleteFile();
+                            dump = std::make_unique<juce::FileOutputStream>(file);
+                        }
+
+                        auto result = runBenchmark(config, bpm, seconds, lanes, automateEvery, dump.get());
+
+                        std::cout << juce::String::formatted("%-6d %5d %5d %4d %4d %8d %10.0f %10.0f %10.0f %10.0f %10.0f %12.4f%%\n",
+                            juce::roundToInt(sampleRate), blockSize, order, held, offset, result.numEvents,
+                            result.mean, result.p50, result.p99, result.p999, result.worst,
+                            100.0 * result.worst / result.budget);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
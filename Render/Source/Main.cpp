@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    This file contains the startup code for the hARPy offline renderer.
+
+    It streams Standard MIDI Files through the arpeggiator engine, using each
+    file's tempo map in place of a host, and writes the arpeggiated result
+    next to the others in an output folder. Files are rendered in parallel,
+    one renderer per core.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/ArpProgramBank.h"
+#include "MidiFileRenderer.h"
+#include "WorkStealingPool.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+//==============================================================================
+/** "Velocity Fine Control" -> "--velocity-fine-control" */
+juce::String getOptionName(const Params::Spec& spec)
+{
+    return "--" + juce::String(spec.id).toLowerCase().replaceCharacter(' ', '-');
+}
+
+/** Parameter defaults, overridden by any matching command line options.
+    Choices may be given by name or by index. */
+ArpeggiatorSettings getSettings(const juce::ArgumentList& args)
+{
+    ParameterSnapshot values;
+
+    for (const auto& spec : Params::specs) {
+        auto value = spec.def;
+        auto option = getOptionName(spec);
+
+        if (args.containsOption(option)) {
+            auto text = args.getValueForOption(option);
+            value = text.getFloatValue();
+
+            if (spec.type == Params::Type::Choice) {
+                for (int i = 0; i <= int(spec.max); ++i) {
+                    if (text.equalsIgnoreCase(spec.choices[i])) {
+                        value = float(i);
+                    }
+                }
+            }
+        }
+
+        values[spec.index] = value;
+    }
+
+    // Decoded the same way as the plugin's programs, out of range values
+    // clamped on the way.
+    ArpProgram program;
+    program.setValues(values);
+    return program.settings;
+}
+
+struct RenderJob {
+    juce::File source;
+    juce::File destination;
+};
+
+std::vector<RenderJob> findJobs(const juce::ArgumentList& args, const juce::File& outputDir)
+{
+    std::vector<RenderJob> jobs;
+
+    for (const auto& arg : args.arguments) {
+        if (arg.isOption()) {
+            continue;
+        }
+
+        auto file = arg.resolveAsFile();
+
+        if (file.isDirectory()) {
+            for (const auto& child : file.findChildFiles(juce::File::findFiles, true, "*.mid;*.midi")) {
+                auto relative = child.getRelativePathFrom(file);
+                jobs.push_back({ child, outputDir.getChildFile(relative).withFileExtension("mid") });
+            }
+        }
+        else if (file.existsAsFile()) {
+            jobs.push_back({ file, outputDir.getChildFile(file.getFileNameWithoutExtension() + ".mid") });
+        }
+        else {
+            std::cerr << "Skipping " << file.getFullPathName() << ": not found\n";
+        }
+    }
+
+    return jobs;
+}
+
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h") || !args.containsOption("--out")) {
+        std::cout << "Usage: hARPyRender --out=<dir> [--threads=<cores>] [--sample-rate=48000] [--block=512]\n"
+                     "                   [parameter options] <file.mid | folder>...\n\n"
+                     "Parameter options (choices by name or index):\n";
+        for (const auto& spec : Params::specs) {
+            std::cout << "  " << getOptionName(spec) << "\n";
+        }
+        return args.containsOption("--help|-h") ? 0 : 1;
+    }
+
+    auto outputDir = args.getFileForOption("--out");
+    outputDir.createDirectory();
+
+    auto numThreads = args.containsOption("--threads")
+        ? args.getValueForOption("--threads").getIntValue()
+        : juce::SystemStats::getNumCpus();
+    auto sampleRate = args.containsOption("--sample-rate") ? args.getValueForOption("--sample-rate").getDoubleValue() : 48000.0;
+    auto blockSize = args.containsOption("--block") ? juce::jmax(1, args.getValueForOption("--block").getIntValue()) : 512;
+
+    auto settings = getSettings(args);
+    auto jobs = findJobs(args, outputDir);
+
+    WorkStealingPool pool(numThreads);
+
+    std::vector<std::unique_ptr<MidiFileRenderer>> renderers;
+    for (int i = 0; i < pool.getNumThreads(); ++i) {
+        renderers.push_back(std::make_unique<MidiFileRenderer>(settings, sampleRate, blockSize));
+    }
+
+    std::atomic<int> numFailed{ 0 };
+    std::mutex errorLock;
+    auto start = juce::Time::getMillisecondCounterHiRes();
+
+    pool.run(int(jobs.size()), [&](int index, int worker) {
+        const auto& job = jobs[size_t(index)];
+
+        juce::MemoryBlock source;
+        std::vector<std::uint8_t> result;
+        std::string error;
+
+        if (!job.source.loadFileAsData(source)) {
+            error = "can't read file";
+        }
+        else if (renderers[size_t(worker)]->render(static_cast<const std::uint8_t*>(source.getData()), source.getSize(), result, error)) {
+            job.destination.getParentDirectory().createDirectory();
+            if (!job.destination.replaceWithData(result.data(), result.size())) {
+                error = "can't write " + job.destination.getFullPathName().toStdString();
+            }
+        }
+
+        if (!error.empty()) {
+            ++numFailed;
+            std::lock_guard<std::mutex> lock(errorLock);
+            std::cerr << job.source.getFullPathName() << ": " << error << "\n";
+        }
+    });
+
+    auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+    auto numRendered = int(jobs.size()) - numFailed.load();
+
+    std::cout << juce::String::formatted("Rendered %d of %d files in %.2f s on %d threads (%.0f files/min)\n",
+        numRendered, int(jobs.size()), seconds, pool.getNumThreads(),
+        seconds > 0.0 ? 60.0 * numRendered / seconds : 0.0);
+
+    return numFailed.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,419 @@
+/*
+  ==============================================================================
+
+    MidiFileRenderer.cpp
+
+    Streams a Standard MIDI File through ArpEngine, offline.
+
+  ==============================================================================
+*/
+
+#include "MidiFileRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    std::uint32_t readBigEndian(const std::uint8_t* bytes, int numBytes)
+    {
+        std::uint32_t value = 0;
+        for (int i = 0; i < numBytes; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    void appendBigEndian(std::vector<std::uint8_t>& bytes, std::uint32_t value, int numBytes)
+    {
+        for (int i = numBytes - 1; i >= 0; --i) {
+            bytes.push_back(std::uint8_t(value >> (8 * i)));
+        }
+    }
+
+    void appendVariableLength(std::vector<std::uint8_t>& bytes, std::uint32_t value)
+    {
+        std::uint8_t buffer[5];
+        int length = 0;
+
+        do {
+            buffer[length++] = std::uint8_t(value & 0x7f);
+            value >>= 7;
+        } while (value != 0);
+
+        while (length > 1) {
+            bytes.push_back(std::uint8_t(buffer[--length] | 0x80));
+        }
+        bytes.push_back(buffer[0]);
+    }
+
+    void appendTrack(std::vector<std::uint8_t>& file, const std::vector<std::uint8_t>& track)
+    {
+        file.insert(file.end(), { 'M', 'T', 'r', 'k' });
+        appendBigEndian(file, std::uint32_t(track.size()), 4);
+        file.insert(file.end(), track.begin(), track.end());
+    }
+
+    //==============================================================================
+    /** Reads one MTrk chunk an event at a time. */
+    struct TrackCursor {
+        const std::uint8_t* pos;
+        const std::uint8_t* end;
+        std::int64_t tick = 0;
+        std::uint8_t runningStatus = 0;
+        bool isFinished = false;
+
+        bool readVariableLength(std::uint32_t& value) {
+            value = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (pos >= end) {
+                    return false;
+                }
+                auto byte = *pos++;
+                value = (value << 7) | (byte & 0x7f);
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Reads the delta time of the next event, so tick is its time. */
+        bool advance() {
+            std::uint32_t delta = 0;
+            if (pos >= end || !readVariableLength(delta)) {
+                isFinished = true;
+                return pos >= end;
+            }
+            tick += delta;
+            return true;
+        }
+    };
+
+    /** The parts of an event the renderer cares about. */
+    struct TrackEvent {
+        std::uint8_t status = 0;
+        std::uint8_t metaType = 0;
+        const std::uint8_t* data = nullptr;
+        std::uint32_t length = 0;
+    };
+
+    bool readEvent(TrackCursor& track, TrackEvent& event)
+    {
+        if (track.pos >= track.end) {
+            return false;
+        }
+
+        auto status = *track.pos;
+        if (status & 0x80) {
+            ++track.pos;
+        }
+        else if (track.runningStatus != 0) {
+            status = track.runningStatus;
+        }
+        else {
+            return false;
+        }
+
+        event.status = status;
+        event.metaType = 0;
+
+        if (status == 0xff) {
+            if (track.pos >= track.end) {
+                return false;
+            }
+            event.metaType = *track.pos++;
+            if (!track.readVariableLength(event.length)) {
+                return false;
+            }
+        }
+        else if (status == 0xf0 || status == 0xf7) {
+            if (!track.readVariableLength(event.length)) {
+                return false;
+            }
+        }
+        else {
+            // Program change and channel pressure have one data byte.
+            track.runningStatus = status;
+            auto type = status & 0xf0;
+            event.length = (type == 0xc0 || type == 0xd0) ? 1 : 2;
+        }
+
+        if (std::size_t(track.end - track.pos) < event.length) {
+            return false;
+        }
+
+        event.data = track.pos;
+        track.pos += event.length;
+        return true;
+    }
+
+    constexpr std::uint32_t defaultMicrosPerQuarter = 500000;
+}
+
+//==============================================================================
+MidiFileRenderer::MidiFileRenderer(const ArpeggiatorSettings& newSettings, double newSampleRate, int newBlockSize)
+    : settings(newSettings), sampleRate(newSampleRate), blockSize(newBlockSize)
+{
+    input.reserve(1024);
+    output.reserve(8192);
+    pending.reserve(1024);
+}
+
+bool MidiFileRenderer::render(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& result, std::string& error)
+{
+    if (size < 14 || readBigEndian(data, 4) != 0x4d546864 || readBigEndian(data + 4, 4) < 6) {
+        error = "not a Standard MIDI File";
+        return false;
+    }
+
+    auto headerLength = readBigEndian(data + 4, 4);
+    auto numTracks = int(readBigEndian(data + 10, 2));
+    auto division = readBigEndian(data + 12, 2);
+
+    if ((division & 0x8000) != 0 || division == 0) {
+        error = "SMPTE time division is not supported";
+        return false;
+    }
+
+    // Locate the track chunks; unknown chunk types are skipped.
+    std::vector<TrackCursor> tracks;
+    tracks.reserve(std::size_t(numTracks));
+
+    for (std::size_t pos = 8 + headerLength; pos + 8 <= size && int(tracks.size()) < numTracks;) {
+        auto chunkLength = std::size_t(readBigEndian(data + pos + 4, 4));
+        auto chunkEnd = std::min(size, pos + 8 + chunkLength);
+
+        if (readBigEndian(data + pos, 4) == 0x4d54726b) {
+            tracks.push_back({ data + pos + 8, data + chunkEnd });
+        }
+        pos = chunkEnd;
+    }
+
+    for (auto& track : tracks) {
+        if (!track.advance()) {
+            error = "corrupt track";
+            return false;
+        }
+    }
+
+    ticksPerQuarter = int(division);
+    segment = {};
+    transport = {};
+    transport.isPlaying = true;
+    meterTick = 0;
+    setTempo(0, defaultMicrosPerQuarter);
+
+    engine.setSettings(settings);
+    engine.prepare(sampleRate);
+    blockStart = 0;
+    pending.clear();
+    conductorTrack.clear();
+    noteTrack.clear();
+    conductorTick = 0;
+    noteTick = 0;
+
+    std::int64_t lastSample = 0;
+
+    // Merge the tracks in time order; on equal ticks the lower track wins,
+    // so a tempo change in the conductor track applies to notes at its tick.
+    for (;;) {
+        TrackCursor* next = nullptr;
+        for (auto& track : tracks) {
+            if (!track.isFinished && (next == nullptr || track.tick < next->tick)) {
+                next = &track;
+            }
+        }
+
+        if (next == nullptr) {
+            break;
+        }
+
+        TrackEvent event;
+        if (!readEvent(*next, event)) {
+            error = "corrupt track";
+            return false;
+        }
+
+        auto tick = next->tick;
+        auto sample = std::int64_t(std::llround(getSampleForTick(tick)));
+        lastSample = std::max(lastSample, sample);
+
+        while (sample >= blockStart + blockSize) {
+            if (!runBlock(blockSize, error)) {
+                return false;
+            }
+        }
+
+        auto type = event.status & 0xf0;
+
+        if (event.status == 0xff && event.metaType == 0x2f) {
+            next->isFinished = true;
+            continue;
+        }
+
+        if (event.status == 0xff && (event.metaType == 0x51 || event.metaType == 0x58)) {
+            // Cut the block here so every block has a single tempo.
+            if (sample > blockStart && !runBlock(int(sample - blockStart), error)) {
+                return false;
+            }
+
+            if (event.metaType == 0x51 && event.length == 3) {
+                setTempo(tick, readBigEndian(event.data, 3));
+            }
+            else if (event.metaType == 0x58 && event.length >= 2 && event.data[1] < 8) {
+                transport.timeSigNumerator = event.data[0];
+                transport.timeSigDenominator = 1 << event.data[1];
+                meterTick = tick;
+            }
+
+            std::uint8_t meta[] = { 0xff, event.metaType };
+            writeEvent(conductorTrack, conductorTick, tick, meta, 2);
+            appendVariableLength(conductorTrack, event.length);
+            conductorTrack.insert(conductorTrack.end(), event.data, event.data + event.length);
+        }
+        else if (type == 0x80 || type == 0x90) {
+            auto isNoteOn = type == 0x90 && event.data[1] != 0;
+            pending.push_back({ std::int32_t(sample - blockStart),
+                                isNoteOn ? ArpEvent::NoteOn : ArpEvent::NoteOff,
+                                std::uint8_t((event.status & 0x0f) + 1),
+                                std::uint8_t(event.data[0] & 0x7f),
+                                std::uint8_t(event.data[1] & 0x7f) });
+        }
+
+        if (!next->advance()) {
+            error = "corrupt track";
+            return false;
+        }
+    }
+
+    // Play out whatever is pending and let the last step ring out. Notes the
+    // file never releases would arpeggiate forever, so those are cut.
+    while (blockStart <= lastSample || (engine.hasOpenGates() && engine.getNumHeldNotes() == 0)) {
+        if (!runBlock(blockSize, error)) {
+            return false;
+        }
+    }
+
+    output.clear();
+    engine.panic(output);
+    for (const auto& event : output) {
+        if (event.type == ArpEvent::NoteOff) {
+            std::uint8_t bytes[] = { std::uint8_t(0x80 | (event.channel - 1)), event.note, 0 };
+            writeEvent(noteTrack, noteTick, getTickForSample(blockStart), bytes, 3);
+        }
+    }
+
+    std::uint8_t endOfTrack[] = { 0xff, 0x2f, 0x00 };
+    writeEvent(conductorTrack, conductorTick, conductorTick, endOfTrack, 3);
+    writeEvent(noteTrack, noteTick, noteTick, endOfTrack, 3);
+
+    result.clear();
+    result.insert(result.end(), { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 2 });
+    appendBigEndian(result, division, 2);
+    appendTrack(result, conductorTrack);
+    appendTrack(result, noteTrack);
+
+    return true;
+}
+
+void MidiFileRenderer::setTempo(std::int64_t tick, std::uint32_t microsPerQuarter)
+{
+    if (microsPerQuarter == 0) {
+        return;
+    }
+
+    segment.sample = getSampleForTick(tick);
+    segment.tick = tick;
+    segment.samplesPerTick = sampleRate * double(microsPerQuarter) * 1.0e-6 / double(ticksPerQuarter);
+    segment.bpm = 60.0e6 / double(microsPerQuarter);
+}
+
+double MidiFileRenderer::getSampleForTick(std::int64_t tick) const
+{
+    return segment.sample + double(tick - segment.tick) * segment.samplesPerTick;
+}
+
+std::int64_t MidiFileRenderer::getTickForSample(std::int64_t sample) const
+{
+    return segment.tick + std::llround((double(sample) - segment.sample) / segment.samplesPerTick);
+}
+
+bool MidiFileRenderer::runBlock(int numSamples, std::string& error)
+{
+    // Hand the engine the events that fall in this block and keep the rest,
+    // rebased, for the next one.
+    auto split = std::find_if(pending.begin(), pending.end(),
+                              [numSamples](const ArpEvent& event) { return event.offset >= numSamples; });
+    auto numDue = int(split - pending.begin());
+
+    if (numDue > 1024) {
+        input.reserve(numDue);
+    }
+
+    input.clear();
+    for (auto it = pending.begin(); it != split; ++it) {
+        input.add(*it);
+    }
+
+    pending.erase(pending.begin(), split);
+    for (auto& event : pending) {
+        event.offset -= numSamples;
+    }
+
+    transport.bpm = segment.bpm;
+    transport.ppqPosition = (double(segment.tick) + (double(blockStart) - segment.sample) / segment.samplesPerTick)
+                          / double(ticksPerQuarter);
+
+    // A time signature event starts a bar, so the bars since the last one
+    // give the bar start the way a host would.
+    auto meterPpq = double(meterTick) / double(ticksPerQuarter);
+    auto barLength = 4.0 * transport.timeSigNumerator / transport.timeSigDenominator;
+    transport.hasBarStart = true;
+    transport.ppqPositionOfLastBarStart = meterPpq + std::floor((transport.ppqPosition - meterPpq) / barLength + 1.0e-9) * barLength;
+
+    output.clear();
+    engine.process(transport, numSamples, input, output);
+
+    // A block with more notes than the buffer holds would come out with
+    // some missing, which is worse than no file at all.
+    if (output.getNumDropped() > 0) {
+        error = "more than " + std::to_string(output.size()) + " note events in one block; try a smaller --block";
+        return false;
+    }
+
+    for (const auto& event : output) {
+        auto tick = getTickForSample(blockStart + event.offset);
+        auto channel = std::uint8_t(event.channel - 1);
+
+        switch (event.type) {
+        case ArpEvent::NoteOn: {
+            std::uint8_t bytes[] = { std::uint8_t(0x90 | channel), event.note, event.velocity };
+            writeEvent(noteTrack, noteTick, tick, bytes, 3);
+            break;
+        }
+        case ArpEvent::NoteOff: {
+            std::uint8_t bytes[] = { std::uint8_t(0x80 | channel), event.note, 0 };
+            writeEvent(noteTrack, noteTick, tick, bytes, 3);
+            break;
+        }
+        case ArpEvent::AllNotesOff: {
+            std::uint8_t bytes[] = { std::uint8_t(0xb0 | channel), 123, 0 };
+            writeEvent(noteTrack, noteTick, tick, bytes, 3);
+            break;
+        }
+        }
+    }
+
+    blockStart += numSamples;
+    return true;
+}
+
+void MidiFileRenderer::writeEvent(std::vector<std::uint8_t>& track, std::int64_t& lastTick, std::int64_t tick,
+                                  const std::uint8_t* bytes, std::size_t numBytes)
+{
+    // Rounding samples back to ticks must never reorder events.
+    tick = std::max(tick, lastTick);
+    appendVariableLength(track, std::uint32_t(tick - lastTick));
+    track.insert(track.end(), bytes, bytes + numBytes);
+    lastTick = tick;
+}
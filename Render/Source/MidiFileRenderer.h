@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    MidiFileRenderer.h
+
+    Streams a Standard MIDI File through ArpEngine, offline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../../Source/ArpEngine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//==============================================================================
+/**
+    Renders Standard MIDI Files through the arpeggiator as fast as possible.
+
+    The file's tracks are merged on the fly straight from its bytes, with one
+    cursor per track, so no event list is ever built. Tempo and time signature
+    events take the place of the host's play head: blocks are cut at every
+    change, and each block's transport is computed from the tempo map. Notes
+    are fed to the engine and its output is encoded as it comes out.
+
+    The result is a format 1 file with the same resolution: a conductor track
+    carrying the tempo map and a track with the arpeggiated notes. Only notes
+    go through the arpeggiator, so controllers and other events are dropped.
+
+    One renderer per thread; its buffers are reused from file to file, so the
+    memory it holds is bounded by the largest file it has seen.
+*/
+class MidiFileRenderer {
+public:
+    MidiFileRenderer(const ArpeggiatorSettings& settings, double sampleRate, int blockSize);
+
+    /** Renders one file held in memory. Returns false, with a message in
+        error, if the file isn't a MIDI file this can read. */
+    bool render(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& result, std::string& error);
+
+private:
+    struct Segment {
+        std::int64_t tick = 0;
+        double sample = 0.0;
+        double samplesPerTick = 0.0;
+        double bpm = 120.0;
+    };
+
+    void setTempo(std::int64_t tick, std::uint32_t microsPerQuarter);
+    double getSampleForTick(std::int64_t tick) const;
+    std::int64_t getTickForSample(std::int64_t sample) const;
+    /** Runs the engine over one block and writes what it played. Returns
+        false, with a message in error, if the block overflowed. */
+    bool runBlock(int numSamples, std::string& error);
+    void writeEvent(std::vector<std::uint8_t>& track, std::int64_t& lastTick, std::int64_t tick,
+                    const std::uint8_t* bytes, std::size_t numBytes);
+
+    ArpeggiatorSettings settings;
+    double sampleRate;
+    int blockSize;
+
+    ArpEngine engine;
+    ArpEventBuffer input;
+    ArpEventBuffer output;
+    std::vector<ArpEvent> pending;
+
+    int ticksPerQuarter = 480;
+    Segment segment;
+    ArpTransport transport;
+    std::int64_t meterTick = 0;  // where the current time signature started
+    std::int64_t blockStart = 0;
+
+    std::vector<std::uint8_t> conductorTrack;
+    std::vector<std::uint8_t> noteTrack;
+    std::int64_t conductorTick = 0;
+    std::int64_t noteTick = 0;
+};
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.h
+
+    Spreads a fixed set of jobs over worker threads that steal from each other.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+/**
+    Runs jobs 0..numJobs-1 on a number of threads and waits for all of them.
+
+    Every worker starts with its own contiguous share of the jobs and takes
+    them from the front of its queue. A worker that runs dry steals from the
+    back of another worker's queue, so a few large files don't leave the
+    other cores idle. Jobs are whole files, so a mutex per queue costs
+    nothing measurable next to the work itself.
+
+    job(index, worker) is called with the worker's index, which lets callers
+    keep per-thread state (e.g. one renderer per worker) without locking.
+*/
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int numThreadsToUse)
+        : numThreads(numThreadsToUse > 0 ? numThreadsToUse : 1) {}
+
+    int getNumThreads() const { return numThreads; }
+
+    template <typename Job>
+    void run(int numJobs, Job&& job) {
+        auto queues = std::vector<Queue>(std::size_t(numThreads));
+
+        for (int i = 0; i < numJobs; ++i) {
+            queues[std::size_t(std::int64_t(i) * numThreads / numJobs)].jobs.push_back(i);
+        }
+
+        auto work = [&queues, &job, this](int worker) {
+            for (;;) {
+                auto index = queues[std::size_t(worker)].popFront();
+
+                for (int i = 1; index < 0 && i < numThreads; ++i) {
+                    index = queues[std::size_t((worker + i) % numThreads)].popBack();
+                }
+
+                // No job is ever added once running, so if every queue is
+                // empty there is nothing left to steal.
+                if (index < 0) {
+                    return;
+                }
+
+                job(index, worker);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int worker = 1; worker < numThreads; ++worker) {
+            threads.emplace_back(work, worker);
+        }
+
+        work(0);
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct Queue {
+        int popFront() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (jobs.empty()) {
+                return -1;
+            }
+            auto index = jobs.front();
+            jobs.pop_front();
+            return index;
+        }
+
+        int popBack() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (jobs.empty()) {
+                return -1;
+            }
+            auto index = jobs.back();
+            jobs.pop_back();
+            return index;
+        }
+
+        std::mutex mutex;
+        std::deque<int> jobs;
+    };
+
+    int numThreads;
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    ArpClock.cpp
+
+    Host-locked step clock for the arpeggiator.
+
+  ==============================================================================
+*/
+
+#include "ArpClock.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Below these a position counts as being on the grid or the host as not
+    // having moved, which absorbs floating point noise in host ppq values.
+    constexpr double gridEpsilon = 1.0e-9;
+    constexpr double sampleEpsilon = 1.0e-6;
+}
+
+void ArpClock::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    // Rate choices divide the bar: 1/1 is one bar, 1/2 half a bar and so on.
+    // Triplets fit three steps into the space of two, dotted steps last 3/2.
+    for (int rate = 0; rate < numRates; ++rate) {
+        auto steps = std::int64_t(1) << rate;
+        barFractions[rate][Straight] = { 1, steps };
+        barFractions[rate][Triplet] = { 2, steps * 3 };
+        barFractions[rate][Dotted] = { 3, steps * 2 };
+    }
+
+    reset();
+}
+
+void ArpClock::reset()
+{
+    bpm = 120.0;
+    quartersPerSample = bpm / (60.0 * sampleRate);
+    blockStartPpq = 0.0;
+    gridOriginPpq = 0.0;
+    lastStepPpq = 0.0;
+    needsRealign = true;
+    freeRunOriginPpq = 0.0;
+    freeRunSamples = 0;
+    updateStepLength();
+}
+
+void ArpClock::setRate(int rate, RateType rateType)
+{
+    rate = std::clamp(rate, 0, numRates - 1);
+
+    if (rate != rateIndex || rateType != type) {
+        rateIndex = rate;
+        type = rateType;
+        updateStepLength();
+    }
+}
+
+bool ArpClock::beginBlock(const ArpTransport& transport)
+{
+    auto newBpm = transport.bpm > 0.0 ? transport.bpm : 120.0;
+    auto hasTimeSig = transport.timeSigNumerator > 0 && transport.timeSigDenominator > 0;
+    auto newBeatsInBar = hasTimeSig ? transport.timeSigNumerator : 4;
+    auto newBeatLength = hasTimeSig ? transport.timeSigDenominator : 4;
+
+    if (newBpm != bpm) {
+        freeRunOriginPpq += double(freeRunSamples) * quartersPerSample;
+        freeRunSamples = 0;
+        bpm = newBpm;
+        quartersPerSample = bpm / (60.0 * sampleRate);
+    }
+
+    if (transport.isPlaying) {
+        freeRunOriginPpq = transport.ppqPosition;
+        freeRunSamples = 0;
+    }
+
+    blockStartPpq = freeRunOriginPpq + double(freeRunSamples) * quartersPerSample;
+
+    if (newBeatsInBar != beatsInBar || newBeatLength != beatLength) {
+        beatsInBar = newBeatsInBar;
+        beatLength = newBeatLength;
+        updateStepLength();
+    }
+
+    updateGridOrigin(transport);
+
+    // After a start, loop or seek, pick the grid up again at the host position.
+    auto tolerance = quartersPerSample;
+    if (needsRealign
+        || blockStartPpq < lastStepPpq - tolerance
+        || blockStartPpq > getNextStepPpq() + tolerance) {
+        lastStepPpq = gridOriginPpq + (std::ceil((blockStartPpq - gridOriginPpq) / stepLength - gridEpsilon) - 1.0) * stepLength;
+        needsRealign = false;
+        return true;
+    }
+
+    return false;
+}
+
+void ArpClock::endBlock(int numSamples)
+{
+    freeRunSamples += numSamples;
+}
+
+int ArpClock::getNextStepOffset() const
+{
+    return getOffsetForPpq(getNextStepPpq());
+}
+
+int ArpClock::getGateEndOffset(float noteLength) const
+{
+    return getOffsetForPpq(lastStepPpq + double(noteLength) * stepLength);
+}
+
+void ArpClock::advanceStep()
+{
+    lastStepPpq = getNextStepPpq();
+}
+
+std::int64_t ArpClock::getNextStepIndex() const
+{
+    return std::int64_t(std::floor((getNextStepPpq() - gridOriginPpq) / stepLength + gridEpsilon));
+}
+
+void ArpClock::updateStepLength()
+{
+    // A bar holds 4 * beatsInBar / beatLength quarter notes.
+    const auto& fraction = barFractions[rateIndex][type];
+    stepLength = double(4 * beatsInBar * fraction.num) / double(beatLength * fraction.den);
+}
+
+void ArpClock::updateGridOrigin(const ArpTransport& transport)
+{
+    // Bars of the current time signature, carried back from the last one to
+    // the first at or after ppq 0. While the time signature stays the same
+    // this doesn't move, so neither do the steps of rates that don't divide
+    // the bar; a change moves it to the new bar lines.
+    if (!transport.hasBarStart) {
+        gridOriginPpq = 0.0;
+        return;
+    }
+
+    auto barLength = double(4 * beatsInBar) / double(beatLength);
+    auto barStart = transport.ppqPositionOfLastBarStart;
+    auto origin = barStart - std::floor(barStart / barLength) * barLength;
+
+    // Host ppq values are a little off now and then; a bar start just either
+    // side of a whole number of bars is on one.
+    auto isOnWholeBars = origin < gridEpsilon * barLength || barLength - origin < gridEpsilon * barLength;
+    gridOriginPpq = isOnWholeBars ? 0.0 : origin;
+}
+
+double ArpClock::getNextStepPpq() const
+{
+    // Step positions are always origin + index * length, never a running sum.
+    return gridOriginPpq + (std::floor((lastStepPpq - gridOriginPpq) / stepLength + gridEpsilon) + 1.0) * stepLength;
+}
+
+int ArpClock::getOffsetForPpq(double ppq) const
+{
+    auto samples = std::ceil((ppq - blockStartPpq) / quartersPerSample - sampleEpsilon);
+    return int(std::clamp(samples, double(std::numeric_limits<int>::min()), double(std::numeric_limits<int>::max())));
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    ArpClock.h
+
+    Host-locked step clock for the arpeggiator.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+enum RateType {
+    Straight,
+    Triplet,
+    Dotted,
+};
+
+/** What the host says about its transport for the coming block. */
+struct ArpTransport {
+    double bpm = 120.0;
+    int timeSigNumerator = 4;
+    int timeSigDenominator = 4;
+    bool isPlaying = false;
+    double ppqPosition = 0.0;
+    bool hasBarStart = false;  // whether the host gave the position below
+    double ppqPositionOfLastBarStart = 0.0;
+};
+
+//==============================================================================
+/**
+    Places arpeggio steps on a grid of quarter-note (ppq) positions.
+
+    While the host is playing, every block is locked to the host's ppq
+    position, so steps follow tempo changes and never drift. When there is no
+    transport (standalone, stopped host) the clock runs on its own from an
+    origin ppq plus a whole number of samples, rebased whenever the tempo
+    changes, so it doesn't accumulate rounding errors either.
+
+    Step lengths are exact fractions of a bar, one per Rate/Rate Type choice,
+    and are precomputed in prepare(). The grid runs through the host's bar
+    lines: steps lie a whole number of step lengths from the last bar start,
+    counted from where the first bar would have started had the current time
+    signature held since ppq 0. After a change of time signature the steps
+    still land on the bar lines; without one, or when the host doesn't say
+    where its bars start, the grid starts at ppq 0.
+*/
+class ArpClock {
+public:
+    static constexpr int numRates = 7;
+    static constexpr int numRateTypes = 3;
+
+    void prepare(double newSampleRate);
+    void reset();
+
+    /** Selects the step length; cheap to call when nothing has changed. */
+    void setRate(int rate, RateType rateType);
+
+    /** Reads tempo, time signature and position for the coming block.
+        Returns true if the grid had to be picked up at a new position
+        (start, loop, seek) instead of carrying on from the last block. */
+    bool beginBlock(const ArpTransport& transport);
+    void endBlock(int numSamples);
+
+    /** Sample offsets within the current block; may lie beyond its end, or
+        before its start when the event is already late. */
+    int getNextStepOffset() const;
+    int getGateEndOffset(float noteLength) const;
+
+    /** Marks the pending step as played. */
+    void advanceStep();
+
+    /** Index of the pending step on the grid, counted from its origin. */
+    std::int64_t getNextStepIndex() const;
+
+    /** Where step 0 of the grid is; a multiple of the bar length away from
+        the last bar start, and 0 unless the time signature has changed. */
+    double getGridOriginPpq() const { return gridOriginPpq; }
+
+    double getBpm() const { return bpm; }
+    double getStepLengthInQuarters() const { return stepLength; }
+    double getSamplesPerStep() const { return stepLength / quartersPerSample; }
+    double getBlockStartPpq() const { return blockStartPpq; }
+    double getQuartersPerSample() const { return quartersPerSample; }
+
+private:
+    struct Fraction {
+        std::int64_t num;
+        std::int64_t den;
+    };
+
+    void updateStepLength();
+    void updateGridOrigin(const ArpTransport& transport);
+    double getNextStepPpq() const;
+    int getOffsetForPpq(double ppq) const;
+
+    std::array<std::array<Fraction, numRateTypes>, numRates> barFractions{};
+
+    double sampleRate = 44100.0;
+    double bpm = 120.0;
+    double quartersPerSample = 0.0;
+    double stepLength = 1.0;
+
+    int rateIndex = 0;
+    RateType type = Straight;
+    int beatsInBar = 4;
+    int beatLength = 4;
+
+    double blockStartPpq = 0.0;
+    double gridOriginPpq = 0.0;
+    double lastStepPpq = 0.0;
+    bool needsRealign = true;
+
+    double freeRunOriginPpq = 0.0;
+    std::int64_t freeRunSamples = 0;
+};
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    ArpCommandQueue.h
+
+    Wait-free hand-over of note-set commands to the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+
+enum class ArpCommand : juce::uint32 {
+    Panic = 1 << 0,
+};
+
+//==============================================================================
+/**
+    Commands posted from the message thread or host threads and drained by the
+    audio thread at the start of each block.
+
+    Commands are idempotent, so pending ones are kept as bits in one atomic
+    word: posting is a single fetch_or and draining a single exchange. Neither
+    side ever waits, however many threads post at once, and the queue can't
+    overflow. Drained commands are handed out in a fixed order, Panic first.
+*/
+class ArpCommandQueue {
+public:
+    void post(ArpCommand command) noexcept {
+        pending.fetch_or(juce::uint32(command), std::memory_order_release);
+    }
+
+    template <typename Handler>
+    void drain(Handler&& handle) noexcept {
+        auto commands = pending.exchange(0, std::memory_order_acquire);
+
+        for (auto command : { ArpCommand::Panic }) {
+            if ((commands & juce::uint32(command)) != 0) {
+                handle(command);
+            }
+        }
+    }
+
+    void clear() noexcept { pending.store(0); }
+
+private:
+    std::atomic<juce::uint32> pending{ 0 };
+};
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    ArpDisplayFifo.h
+
+    Wait-free hand-over of what the arpeggiator played to the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+
+/** One block header or one note, as seen by the editor. */
+struct ArpDisplayEvent {
+    enum Type : juce::uint8 {
+        Block,
+        NoteOn,
+        NoteOff,
+        AllNotesOff,
+    };
+
+    Type type;
+    juce::uint8 channel;
+    juce::uint8 note;
+    juce::uint8 velocity;
+    bool isPlaying;          // Block only
+    float bpm;               // Block only
+    double ppq;              // block start, or the note's position
+    double stepLength;       // Block only, in quarter notes
+    double gridOrigin;       // Block only, ppq of step 0
+    juce::int64 lastStep;    // Block only, index of the last step on the grid
+};
+
+//==============================================================================
+/**
+    Single-producer, single-consumer ring from processBlock to the editor.
+
+    The audio thread pushes a block header followed by the block's notes; the
+    editor drains whatever has arrived once per frame. Storage is a fixed
+    array indexed through an AbstractFifo, so neither side ever locks or
+    allocates. When the editor is slow or closed the ring fills up and the
+    audio thread drops whole blocks, which the editor can tell from a gap in
+    the positions.
+*/
+class ArpDisplayFifo {
+public:
+    static constexpr int capacity = 2048;
+
+    /** Audio thread: writes getEvent(0)..getEvent(numEvents - 1), or nothing
+        if they don't all fit. */
+    template <typename Source>
+    void push(int numEvents, Source&& getEvent) noexcept {
+        if (fifo.getFreeSpace() < numEvents) {
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        int i = 0;
+        fifo.write(numEvents).forEach([&](int index) {
+            events[std::size_t(index)] = getEvent(i++);
+        });
+    }
+
+    /** Editor: hands out at most maxEvents of the waiting events, oldest
+        first, and returns how many there were. */
+    template <typename Handler>
+    int drain(Handler&& handle, int maxEvents = capacity) noexcept {
+        auto scope = fifo.read(juce::jmin(maxEvents, fifo.getNumReady()));
+
+        scope.forEach([&](int index) {
+            handle(events[std::size_t(index)]);
+        });
+
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    /** Blocks that didn't fit since the plugin was loaded. */
+    int getNumDropped() const noexcept { return numDropped.load(std::memory_order_relaxed); }
+
+private:
+    juce::AbstractFifo fifo{ capacity };
+    std::array<ArpDisplayEvent, capacity> events{};
+    std::atomic<int> numDropped{ 0 };
+};
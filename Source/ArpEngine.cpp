@@ -0,0 +1,389 @@
+/*
+  ==============================================================================
+
+    ArpEngine.cpp
+
+    The arpeggiator itself, in plain C++ with no dependency on JUCE.
+
+  ==============================================================================
+*/
+
+#include "ArpEngine.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+void ArpEngine::prepare(double sampleRate)
+{
+    lanes.clear();
+    noteOffs.clear();
+    voices.clear();
+    blockStartSample = 0;
+    clock.prepare(sampleRate);
+    clock.setRate(int(settings.rate), settings.rateType);
+}
+
+void ArpEngine::setSettings(const ArpeggiatorSettings& newSettings)
+{
+    auto previous = settings;
+
+    settings = newSettings;
+    clock.setRate(int(settings.rate), settings.rateType);
+
+    if (settings.seed != previous.seed) {
+        lanes.invalidateShuffles();
+    }
+
+    if (settings.transform != previous.transform) {
+        transform.bake(settings.transform);
+    }
+
+    // Held chords take the new Delta/Offsets at once, without being let go.
+    if (settings.delta != previous.delta || settings.offsets != previous.offsets) {
+        ArpLanes::forEach(lanes.heldMask, [this](int lane) {
+            lanes.expansions[lane].update(lanes.heldKeys[lane], settings.delta, settings.offsets);
+        });
+    }
+}
+
+void ArpEngine::panic(ArpEventBuffer& output)
+{
+    for (const auto& noteOff : noteOffs) {
+        output.add({ 0, ArpEvent::NoteOff, noteOff.channel, noteOff.note, 0 });
+    }
+    noteOffs.clear();
+    voices.clear();
+
+    auto numChannels = settings.perChannel ? ArpLanes::maxLanes : 1;
+    for (int channel = 1; channel <= numChannels; ++channel) {
+        output.add({ 0, ArpEvent::AllNotesOff, std::uint8_t(channel), 0, 0 });
+    }
+
+    lanes.clear();
+}
+
+ArpEngine::BlockStats ArpEngine::process(const ArpTransport& transport, int numSamples,
+                                         const ArpEventBuffer& input, ArpEventBuffer& output,
+                                         const ArpSettingsChangeBuffer* changes,
+                                         const ArpSidechainBlock* sidechain)
+{
+    beginBlock(transport);
+    auto stats = render(numSamples, input, output, changes, sidechain);
+    endBlock(numSamples);
+    return stats;
+}
+
+void ArpEngine::beginBlock(const ArpTransport& transport)
+{
+    // Nothing to catch up on after a loop or seek: every step is worked out
+    // from its position on the grid.
+    clock.beginBlock(transport);
+}
+
+ArpEngine::BlockStats ArpEngine::render(int numSamples, const ArpEventBuffer& input, ArpEventBuffer& output,
+                                        const ArpSettingsChangeBuffer* changes,
+                                        const ArpSidechainBlock* sidechain)
+{
+    BlockStats stats;
+
+    // Walk the block in timestamp order so that every step and note-off that
+    // falls due is emitted, whatever the buffer size. Events sharing a sample
+    // are ordered settings change, note-off, incoming MIDI, step, so a step
+    // already uses settings automated onto its sample, a chord that lands
+    // right on a step is played by it and a gate of exactly one step ends
+    // before the next one starts. All lanes share the clock, so each step is one
+    // pass over the lanes that hold notes. Anything due before the current
+    // position is played at it, and counted as late (steps, note-offs) or
+    // clamped (input). Sidechain onsets come last, like steps; with Steps
+    // on Onsets they play the steps and the grid only keeps time.
+    auto next = input.begin();
+    auto change = (changes != nullptr) ? changes->begin() : nullptr;
+    auto lastChange = (changes != nullptr) ? changes->end() : nullptr;
+    auto onset = (sidechain != nullptr) ? sidechain->onsets : nullptr;
+    auto lastOnset = (sidechain != nullptr) ? sidechain->onsets + sidechain->numOnsets : nullptr;
+    auto getLevel = [sidechain](int offset) { return (sidechain != nullptr) ? sidechain->getLevel(offset) : 1.f; };
+    auto pos = 0;
+
+    while (pos < numSamples) {
+        auto nextChange = (change != lastChange) ? std::clamp(int(change->offset), pos, numSamples) : numSamples;
+        auto nextInput = (next != input.end()) ? std::clamp(int(next->offset), pos, numSamples - 1) : numSamples;
+        auto nextGate = !noteOffs.isEmpty() ? std::max(pos, getNoteOffOffset()) : numSamples;
+        auto nextStep = std::max(pos, clock.getNextStepOffset());
+        auto nextOnset = (onset != lastOnset) ? std::clamp(int(*onset), pos, numSamples) : numSamples;
+        auto nextEvent = std::min({ nextChange, nextInput, nextGate, nextStep, nextOnset });
+
+        if (nextEvent >= numSamples) {
+            break;
+        }
+
+        pos = nextEvent;
+
+        if (nextEvent == nextChange) {
+            setSettings(change->settings);
+            ++change;
+        }
+        else if (nextEvent == nextGate) {
+            if (getNoteOffOffset() < pos) {
+                ++stats.late;
+            }
+            endNotes(pos, output);
+        }
+        else if (nextEvent == nextInput) {
+            if (next->offset != pos) {
+                ++stats.clamped;
+            }
+            if (!handleInput(*next)) {
+                ++stats.strayNoteOffs;
+            }
+            ++next;
+        }
+        else if (nextEvent == nextStep) {
+            if (clock.getNextStepOffset() < pos && !settings.stepsOnOnsets) {
+                ++stats.late;
+            }
+            auto step = clock.getNextStepIndex();
+            clock.advanceStep();
+            if (!settings.stepsOnOnsets) {
+                playSteps(step, pos, getLevel(pos), output);
+            }
+        }
+        else {
+            ++onset;
+            if (settings.stepsOnOnsets) {
+                playSteps(nextOnsetStep++, pos, getLevel(pos), output);
+            }
+        }
+    }
+
+    // Changes stamped at or past the end of the block still leave their mark.
+    for (; change != lastChange; ++change) {
+        setSettings(change->settings);
+    }
+
+    return stats;
+}
+
+int ArpEngine::getNextEventOffset() const
+{
+    // Steps with nothing held play nothing.
+    auto next = std::numeric_limits<int>::max();
+    if (lanes.heldMask != 0 && !settings.stepsOnOnsets) {
+        next = clock.getNextStepOffset();
+    }
+    return !noteOffs.isEmpty() ? std::min(next, getNoteOffOffset()) : next;
+}
+
+int ArpEngine::getNumHeldNotes() const
+{
+    auto numHeld = 0;
+    ArpLanes::forEach(lanes.heldMask, [this, &numHeld](int lane) {
+        numHeld += lanes.expansions[lane].size();
+    });
+    return numHeld;
+}
+
+template <typename Fn>
+void ArpEngine::forEachChordNote(int lane, Fn&& fn) const
+{
+    const auto& keys = lanes.heldKeys[lane];
+    const auto& expansion = lanes.expansions[lane];
+
+    for (int i = 0; i < expansion.size(); ++i) {
+        fn(expansion.get(keys, i));
+    }
+}
+
+std::int64_t ArpEngine::getNextStepIndex() const
+{
+    // Steps played on onsets are simply counted, so patterns, repeats and
+    // modulation lanes go round with the hits instead of the grid.
+    return settings.stepsOnOnsets ? nextOnsetStep : clock.getNextStepIndex();
+}
+
+std::uint32_t ArpEngine::getLaneSeed(int lane) const
+{
+    // Seeds only go up to 9999, so the lane number in the upper bits gives
+    // each lane a stream of its own; lane 0 keeps the plain seed.
+    return std::uint32_t(settings.seed) + (std::uint32_t(lane) << 16);
+}
+
+ArpStep ArpEngine::locateStep(int lane, std::int64_t step, StepSequence& sequence, std::int64_t& shuffledCycle) const
+{
+    if (sequence.update(lanes.expansions[lane].size(), settings.order)) {
+        shuffledCycle = ArpLanes::noCycle;
+    }
+
+    // Chord Repeat plays the whole chord on every step, so each step is a
+    // cycle of its own as far as Repeats is concerned.
+    auto length = (settings.order == ChordRepeat) ? 1 : sequence.size();
+    auto arpStep = getArpStep(step, lanes.anchorStep[lane], length, settings.repeats);
+
+    if (settings.order == Random && arpStep.cycle != shuffledCycle) {
+        sequence.shuffle(getLaneSeed(lane), lanes.anchorStep[lane], arpStep.cycle);
+        shuffledCycle = arpStep.cycle;
+    }
+
+    return arpStep;
+}
+
+bool ArpEngine::modulate(int lane, std::int64_t step, ArpModulation::Step& modulationStep) const
+{
+    // The lanes restart with each new chord, like the pattern.
+    modulationStep = modulation.getStep(step - lanes.anchorStep[lane]);
+
+    if (modulationStep.isCertain()) {
+        return true;
+    }
+
+    // A stream apart from the Random order's, drawn fresh for every grid
+    // step, so a looped section makes the same choices each time round.
+    ArpRandom rng;
+    rng.seed(getLaneSeed(lane) ^ 0x50524f42u, step);
+    return modulationStep.plays(rng.next());
+}
+
+bool ArpEngine::handleInput(const ArpEvent& event)
+{
+    // In Per Channel mode every input channel drives its own lane.
+    auto lane = settings.perChannel ? std::clamp(int(event.channel) - 1, 0, ArpLanes::maxLanes - 1) : 0;
+    auto& heldKeys = lanes.heldKeys[lane];
+    auto wasHeld = (lanes.heldMask & ArpLanes::bitFor(lane)) != 0;
+
+    switch (event.type) {
+    case ArpEvent::NoteOn:
+        heldKeys.add(event.note, event.velocity);
+        break;
+    case ArpEvent::NoteOff:
+        if (!heldKeys.contains(event.note)) {
+            return false;
+        }
+        heldKeys.remove(event.note);
+        break;
+    case ArpEvent::AllNotesOff:
+        return false;
+    }
+
+    lanes.expansions[lane].update(heldKeys, settings.delta, settings.offsets);
+
+    if (heldKeys.isEmpty()) {
+        lanes.heldMask &= ~ArpLanes::bitFor(lane);
+    }
+    else {
+        lanes.heldMask |= ArpLanes::bitFor(lane);
+
+        // A new chord counts its pattern and its repeats from the next step.
+        if (!wasHeld) {
+            lanes.anchorStep[lane] = getNextStepIndex();
+        }
+    }
+
+    return true;
+}
+
+int ArpEngine::getNoteOffOffset() const
+{
+    auto offset = noteOffs.top().time - blockStartSample;
+    return int(std::clamp(offset, std::int64_t(std::numeric_limits<int>::min()), std::int64_t(std::numeric_limits<int>::max())));
+}
+
+void ArpEngine::endNotes(int offset, ArpEventBuffer& output)
+{
+    while (!noteOffs.isEmpty() && noteOffs.top().time <= blockStartSample + offset) {
+        auto noteOff = noteOffs.pop();
+        voices.remove(noteOff.channel, noteOff.note);
+        output.add({ offset, ArpEvent::NoteOff, noteOff.channel, noteOff.note, 0 });
+    }
+}
+
+void ArpEngine::startNote(std::uint8_t channel, std::uint8_t note, std::uint8_t velocity,
+                          int offset, std::int64_t endTime, ArpEventBuffer& output)
+{
+    // A note still sounding from an overlapping gate is ended right before it
+    // is played again. Otherwise, with Max Voices sounding already, the
+    // oldest or quietest is cut short to make room, on this same sample;
+    // after the limit was lowered that may take several.
+    if (noteOffs.remove(channel, note)) {
+        voices.remove(channel, note);
+        output.add({ offset, ArpEvent::NoteOff, channel, note, 0 });
+    }
+
+    auto maxVoices = std::clamp(settings.maxVoices, 1, NoteOffQueue::capacity);
+    while (voices.size() >= maxVoices) {
+        auto victim = voices.getVictim(settings.stealMode);
+        voices.remove(victim.channel, victim.note);
+        noteOffs.remove(victim.channel, victim.note);
+        output.add({ offset, ArpEvent::NoteOff, victim.channel, victim.note, 0 });
+    }
+
+    output.add({ offset, ArpEvent::NoteOn, channel, note, velocity });
+    noteOffs.push({ endTime, channel, note });
+    voices.add(channel, note, velocity);
+}
+
+void ArpEngine::playSteps(std::int64_t step, int offset, float sidechainLevel, ArpEventBuffer& output)
+{
+    ArpLanes::forEach(lanes.heldMask, [this, step, offset, sidechainLevel, &output](int lane) {
+        playStep(lane, step, offset, sidechainLevel, output);
+    });
+}
+
+void ArpEngine::playStep(int lane, std::int64_t step, int offset, float sidechainLevel, ArpEventBuffer& output)
+{
+    const auto& keys = lanes.heldKeys[lane];
+    const auto& expansion = lanes.expansions[lane];
+    auto& sequence = lanes.sequences[lane];
+    auto channel = std::uint8_t(lane + 1);
+
+    if (expansion.isEmpty()) {
+        return;
+    }
+
+    auto arpStep = locateStep(lane, step, sequence, lanes.shuffledCycle[lane]);
+
+    ArpModulation::Step modulationStep;
+    if (!arpStep.isPlayed || !modulate(lane, step, modulationStep)) {
+        return;
+    }
+
+    // Quieter sidechain audio shortens and softens the notes, as far as the
+    // two amounts say.
+    auto follow = [sidechainLevel](float amount) { return 1.f - amount * (1.f - sidechainLevel); };
+    auto noteLength = (settings.noteLength + settings.noteOverlap) * modulationStep.gate * follow(settings.sidechainGate);
+    auto velocityScale = settings.velFineCtrl * modulationStep.velocity * follow(settings.sidechainVelocity);
+
+    // The gate is measured on the grid from the step just played, and may
+    // reach past the steps that follow it. A step played on an onset is off
+    // the grid, so its gate is counted in samples from the onset.
+    auto endTime = settings.stepsOnOnsets
+        ? blockStartSample + offset + std::int64_t(double(noteLength) * clock.getSamplesPerStep())
+        : blockStartSample + clock.getGateEndOffset(noteLength);
+
+    // Notes the transform leaves out, or scaled down to velocity 0 (which
+    // MIDI reads as a note-off), aren't played.
+    auto play = [&](const HeldNoteSet::NoteVel& noteVel) {
+        auto note = transform.getNote(noteVel.note + modulationStep.transpose);
+        auto finalVel = transform.getVelocity(int(float(noteVel.velocity) * velocityScale));
+        if (note != NoteStages::noNote && finalVel > 0) {
+            startNote(channel, std::uint8_t(note), finalVel, offset, endTime, output);
+        }
+    };
+
+    switch (settings.order) {
+    default:
+    case Up:
+    case Down:
+    case UpDown:
+    case DownUp:
+    case UpAndDown:
+    case DownAndUp:
+    case Converge:
+    case Diverge:
+    case Random:
+        play(expansion.get(keys, sequence[arpStep.position]));
+        break;
+    case ChordRepeat:
+        forEachChordNote(lane, play);
+        break;
+    }
+}
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    ArpEngine.h
+
+    The arpeggiator itself, in plain C++ with no dependency on JUCE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ArpClock.h"
+#include "ArpLanes.h"
+#include "ArpModulation.h"
+#include "ArpSidechain.h"
+#include "NoteOffQueue.h"
+#include "NoteTransform.h"
+#include "StepSequence.h"
+#include "VoiceLimiter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+struct ArpeggiatorSettings {
+    float rate{ 0.f };
+    RateType rateType{ Straight };
+    ArpeggioOrder order{ Up };
+    float velFineCtrl{ 1.f };
+    float noteLength{ 1.f };
+    float noteOverlap{ 0.f };  // steps the gate lasts beyond noteLength
+    int repeats{ 0 };
+    int delta{ 0 };
+    int offsets{ 0 };
+    int seed{ 0 };
+    bool perChannel{ false };
+    float sidechainVelocity{ 0.f };  // how far the sidechain level scales
+    float sidechainGate{ 0.f };      // velocity and gate, 0..1
+    bool stepsOnOnsets{ false };     // sidechain onsets play the steps
+    NoteTransformSettings transform;
+    int maxVoices{ VoiceLimiter::capacity };  // notes sounding at once
+    VoiceLimiter::StealMode stealMode{ VoiceLimiter::Oldest };
+};
+
+/** A note event going into or coming out of the engine. */
+struct ArpEvent {
+    enum Type : std::uint8_t {
+        NoteOff,
+        NoteOn,
+        AllNotesOff,
+    };
+
+    std::int32_t offset;
+    Type type;
+    std::uint8_t channel;  // 1..16
+    std::uint8_t note;
+    std::uint8_t velocity;
+};
+
+/** Settings that take effect part-way through a block. */
+struct ArpSettingsChange {
+    std::int32_t offset;
+    ArpeggiatorSettings settings;
+};
+
+//==============================================================================
+/**
+    Fixed-capacity list of events for one block.
+
+    Storage is sized up front by reserve(), off the audio thread; adding to a
+    full buffer drops the event and counts it instead of allocating.
+*/
+template <typename Event>
+class ArpFixedBuffer {
+public:
+    void reserve(int capacity) { events.resize(std::size_t(capacity)); }
+
+    void clear() {
+        numEvents = 0;
+        numDropped = 0;
+    }
+
+    void add(const Event& event) {
+        if (numEvents < int(events.size())) {
+            events[std::size_t(numEvents++)] = event;
+        }
+        else {
+            ++numDropped;
+        }
+    }
+
+    int size() const { return numEvents; }
+    bool isEmpty() const { return numEvents == 0; }
+    int getNumDropped() const { return numDropped; }
+
+    const Event* begin() const { return events.data(); }
+    const Event* end() const { return events.data() + numEvents; }
+
+private:
+    std::vector<Event> events;
+    int numEvents = 0;
+    int numDropped = 0;
+};
+
+using ArpEventBuffer = ArpFixedBuffer<ArpEvent>;
+using ArpSettingsChangeBuffer = ArpFixedBuffer<ArpSettingsChange>;
+
+//==============================================================================
+/**
+    Turns held notes into arpeggiated note events, one block at a time.
+
+    The engine knows nothing about plugins, parameters or MIDI buffers: the
+    caller hands it settings, the host transport and the block's input notes,
+    and gets note events back. Its whole state is trivially copyable, so
+    engines can be stored in plain arrays, copied and snapshotted.
+
+    process() runs one block. Settings changes stamped with a sample offset
+    take effect exactly there, so automation stays tight at any block size.
+    For batches (see ArpEngineBatch) it is split into beginBlock(), render()
+    and endBlock(). An engine with nothing due can sit blocks out entirely
+    and be caught up later, as endBlock() calls add up.
+*/
+class ArpEngine {
+public:
+    /** What happened during a block, for metrics. */
+    struct BlockStats {
+        int late = 0;     // steps and note-offs due before they could be played
+        int clamped = 0;  // input events timestamped outside the block
+        int strayNoteOffs = 0;  // input note-offs for notes that weren't held
+    };
+
+    void prepare(double sampleRate);
+
+    /** Takes new settings; cheap when nothing relevant changed. */
+    void setSettings(const ArpeggiatorSettings& newSettings);
+    const ArpeggiatorSettings& getSettings() const { return settings; }
+
+    /** Takes new modulation lanes, already compiled; a plain copy. */
+    void setModulation(const ArpModulation& newModulation) { modulation = newModulation; }
+
+    /** Ends all sounding notes and forgets every held one. */
+    void panic(ArpEventBuffer& output);
+
+    /** Runs one block. changes, if given, must be sorted by offset; the last
+        of them stays in effect after the block. sidechain, if given, is the
+        block's analysis of the sidechain audio. */
+    BlockStats process(const ArpTransport& transport, int numSamples,
+                       const ArpEventBuffer& input, ArpEventBuffer& output,
+                       const ArpSettingsChangeBuffer* changes = nullptr,
+                       const ArpSidechainBlock* sidechain = nullptr);
+
+    void beginBlock(const ArpTransport& transport);
+    BlockStats render(int numSamples, const ArpEventBuffer& input, ArpEventBuffer& output,
+                      const ArpSettingsChangeBuffer* changes = nullptr,
+                      const ArpSidechainBlock* sidechain = nullptr);
+    void endBlock(int numSamples) {
+        clock.endBlock(numSamples);
+        blockStartSample += numSamples;
+    }
+
+    /** Offset of the next thing render() has to do if no input comes: the
+        next step while notes are held and steps follow the grid, or the
+        next note-off if that is earlier. std::numeric_limits<int>::max()
+        when there is neither. Sidechain onsets can't be known ahead. */
+    int getNextEventOffset() const;
+
+    int getNumHeldNotes() const;
+    bool hasOpenGates() const { return !noteOffs.isEmpty(); }
+    double getBpm() const { return clock.getBpm(); }
+    const ArpClock& getClock() const { return clock; }
+
+private:
+    std::uint32_t getLaneSeed(int lane) const;
+    std::int64_t getNextStepIndex() const;
+    ArpStep locateStep(int lane, std::int64_t step, StepSequence& sequence, std::int64_t& shuffledCycle) const;
+    bool modulate(int lane, std::int64_t step, ArpModulation::Step& modulationStep) const;
+    template <typename Fn>
+    void forEachChordNote(int lane, Fn&& fn) const;
+    bool handleInput(const ArpEvent& event);
+    int getNoteOffOffset() const;
+    void endNotes(int offset, ArpEventBuffer& output);
+    void startNote(std::uint8_t channel, std::uint8_t note, std::uint8_t velocity,
+                   int offset, std::int64_t endTime, ArpEventBuffer& output);
+    void playSteps(std::int64_t step, int offset, float sidechainLevel, ArpEventBuffer& output);
+    void playStep(int lane, std::int64_t step, int offset, float sidechainLevel, ArpEventBuffer& output);
+
+    ArpeggiatorSettings settings;
+    ArpClock clock;
+    ArpLanes lanes;
+    NoteOffQueue noteOffs;
+    VoiceLimiter voices;  // the same notes as noteOffs, by age and velocity
+    ArpModulation modulation;
+    NoteTransform transform;
+    std::int64_t blockStartSample = 0;
+    std::int64_t nextOnsetStep = 0;  // steps played on onsets so far
+};
+
+static_assert(std::is_trivially_copyable_v<ArpEngine>);
+
+// Batches step thousands of engines in turn, so one engine's state is kept
+// to a few pages; anything that makes it grow should come with a reason.
+static_assert(sizeof(ArpEngine) <= 20 * 1024);
+
+// Every gate in noteOffs is a voice, so the two must hold as many.
+static_assert(VoiceLimiter::capacity == NoteOffQueue::capacity);
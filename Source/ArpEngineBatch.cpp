@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    ArpEngineBatch.cpp
+
+    Runs many ArpEngines over the same block in one call.
+
+  ==============================================================================
+*/
+
+#include "ArpEngineBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+void ArpEngineBatch::prepare(int numEngines, double newSampleRate, int inputCapacity, int outputCapacity)
+{
+    sampleRate = newSampleRate;
+    engines.resize(std::size_t(numEngines));
+    inputs.resize(std::size_t(numEngines));
+    outputs.resize(std::size_t(numEngines));
+    nextEventSamples.assign(std::size_t(numEngines), noEvent);
+    engineSamples.assign(std::size_t(numEngines), 0);
+    isDue.assign(std::size_t(numEngines), 0);
+    rendered.clear();
+    rendered.reserve(std::size_t(numEngines));
+
+    for (int i = 0; i < numEngines; ++i) {
+        engines[std::size_t(i)].prepare(sampleRate);
+        inputs[std::size_t(i)].reserve(inputCapacity);
+        inputs[std::size_t(i)].clear();
+        outputs[std::size_t(i)].reserve(outputCapacity);
+        outputs[std::size_t(i)].clear();
+    }
+
+    blockStart = 0;
+    lastNumSamples = 0;
+    needsRefresh = true;
+}
+
+void ArpEngineBatch::setSettings(int index, const ArpeggiatorSettings& settings)
+{
+    // A new rate or order moves the engine's next step; it is worked out
+    // again in the next block.
+    auto i = std::size_t(index);
+    engines[i].setSettings(settings);
+    nextEventSamples[i] = std::min(nextEventSamples[i], blockStart);
+}
+
+void ArpEngineBatch::addInput(int index, const ArpEvent& event)
+{
+    auto i = std::size_t(index);
+    inputs[i].add(event);
+    nextEventSamples[i] = std::min(nextEventSamples[i], blockStart);
+}
+
+void ArpEngineBatch::process(const ArpTransport& transport, int numSamples)
+{
+    auto numEngines = engines.size();
+    auto blockEnd = blockStart + numSamples;
+
+    for (auto i : rendered) {
+        outputs[std::size_t(i)].clear();
+    }
+    rendered.clear();
+
+    if (needsRefresh || hasTransportMoved(transport)) {
+        std::fill(nextEventSamples.begin(), nextEventSamples.end(), blockStart);
+        needsRefresh = false;
+    }
+
+    // Plain loop over packed sample positions with no branches, so it
+    // vectorises wherever the target has 64-bit compares (SSE4.2, AVX2,
+    // NEON). It goes through plain pointers, as a store through unsigned
+    // char could otherwise change the vectors' own. The schedule can be a
+    // sample out when the host's ppq rounds differently from it, so an
+    // engine is rendered a sample early rather than a step late.
+    const auto* next = nextEventSamples.data();
+    auto* due = isDue.data();
+    for (std::size_t i = 0; i < numEngines; ++i) {
+        due[i] = (unsigned char)(next[i] <= blockEnd);
+    }
+
+    for (std::size_t i = 0; i < numEngines; ++i) {
+        if (isDue[i] == 0) {
+            continue;
+        }
+
+        auto& engine = engines[i];
+        catchUp(i);
+        engine.beginBlock(transport);
+        engine.render(numSamples, inputs[i], outputs[i]);
+        inputs[i].clear();
+        schedule(i);
+        engine.endBlock(numSamples);
+        engineSamples[i] = blockEnd;
+
+        if (!outputs[i].isEmpty()) {
+            rendered.push_back(int(i));
+        }
+    }
+
+    lastTransport = transport;
+    lastNumSamples = numSamples;
+    blockStart = blockEnd;
+}
+
+bool ArpEngineBatch::hasTransportMoved(const ArpTransport& transport) const
+{
+    if (transport.bpm != lastTransport.bpm
+        || transport.timeSigNumerator != lastTransport.timeSigNumerator
+        || transport.timeSigDenominator != lastTransport.timeSigDenominator
+        || transport.isPlaying != lastTransport.isPlaying
+        || transport.hasBarStart != lastTransport.hasBarStart) {
+        return true;
+    }
+
+    if (!transport.isPlaying) {
+        return false;
+    }
+
+    // Played on from where the last block ended, give or take a sample.
+    auto quartersPerSample = transport.bpm / (60.0 * sampleRate);
+    auto expectedPpq = lastTransport.ppqPosition + double(lastNumSamples) * quartersPerSample;
+    return std::abs(transport.ppqPosition - expectedPpq) > quartersPerSample;
+}
+
+void ArpEngineBatch::catchUp(std::size_t index)
+{
+    // Blocks an engine sat out only move its timeline on, which adds up.
+    for (auto behind = blockStart - engineSamples[index]; behind > 0;) {
+        auto numSamples = int(std::min(behind, std::int64_t(std::numeric_limits<int>::max())));
+        engines[index].endBlock(numSamples);
+        behind -= numSamples;
+    }
+    engineSamples[index] = blockStart;
+}
+
+void ArpEngineBatch::schedule(std::size_t index)
+{
+    // Read while the engine is still on this block, where the offset is
+    // measured from.
+    auto offset = engines[index].getNextEventOffset();
+    nextEventSamples[index] = (offset == std::numeric_limits<int>::max()) ? noEvent : blockStart + offset;
+}
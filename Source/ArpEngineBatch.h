@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    ArpEngineBatch.h
+
+    Runs many ArpEngines over the same block in one call.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ArpEngine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+//==============================================================================
+/**
+    A set of engines that share a transport, e.g. the arpeggios of one song
+    being rendered on a server.
+
+    The batch keeps its own schedule next to the engines, structure-of-arrays:
+    the sample at which each engine next has something to do (its next step
+    while it holds notes, or its first note-off) and how far each engine has
+    been run. A block is one branch-free pass comparing the packed schedule
+    with the block's end, then a render of only the engines that are due.
+    The rest aren't touched at all, not even their clocks; an engine that was
+    left alone is moved on in one go when it is next due. In short blocks
+    most engines are idle, so the bulk of a batch costs one comparison each.
+
+    The schedule is worked out at the current tempo, so a change of tempo,
+    time signature or play state, or a jump in position, has every engine
+    looked at again in that block.
+
+    Settings are taken between blocks through setSettings(); the batch has
+    no sample-accurate settings changes and no sidechain, which a server
+    rendering MIDI doesn't have either.
+*/
+class ArpEngineBatch {
+public:
+    /** Sets the number of engines and sizes all buffers; allocates. */
+    void prepare(int numEngines, double sampleRate, int inputCapacity, int outputCapacity);
+
+    int size() const { return int(engines.size()); }
+
+    const ArpEngine& getEngine(int index) const { return engines[std::size_t(index)]; }
+
+    /** Gives an engine new settings, from the next block on. */
+    void setSettings(int index, const ArpeggiatorSettings& settings);
+
+    /** Queues a note for an engine's next block, at an offset within it. */
+    void addInput(int index, const ArpEvent& event);
+
+    /** The engine's events from the last block. */
+    const ArpEventBuffer& getOutput(int index) const { return outputs[std::size_t(index)]; }
+
+    /** Advances every engine by one block. Inputs are consumed; outputs hold
+        this block's events until the next call. */
+    void process(const ArpTransport& transport, int numSamples);
+
+private:
+    static constexpr std::int64_t noEvent = std::numeric_limits<std::int64_t>::max();
+
+    bool hasTransportMoved(const ArpTransport& transport) const;
+    void catchUp(std::size_t index);
+    void schedule(std::size_t index);
+
+    std::vector<ArpEngine> engines;
+    std::vector<ArpEventBuffer> inputs;
+    std::vector<ArpEventBuffer> outputs;
+
+    // The schedule, one entry per engine, in batch samples.
+    std::vector<std::int64_t> nextEventSamples;  // noEvent when idle
+    std::vector<std::int64_t> engineSamples;     // where each engine's own timeline is
+    std::vector<unsigned char> isDue;
+    std::vector<int> rendered;                   // engines whose outputs hold events
+
+    double sampleRate = 44100.0;
+    std::int64_t blockStart = 0;
+    ArpTransport lastTransport;
+    int lastNumSamples = 0;
+    bool needsRefresh = true;
+};
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    ArpLanes.h
+
+    Per-channel arpeggiator state, laid out structure-of-arrays.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "HeldNoteSet.h"
+#include "NoteExpansion.h"
+#include "StepSequence.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+//==============================================================================
+/**
+    The state of up to 16 independent arpeggiators, one per MIDI channel.
+
+    Every lane steps on the same clock, so the processor visits all of them
+    in one pass whenever a step falls due. Each field is its own array
+    indexed by lane, and a bit mask says which lanes hold notes, so a pass
+    only touches the lanes that have something to do. In Omni mode only
+    lane 0 is used.
+*/
+struct ArpLanes {
+    static constexpr int maxLanes = 16;
+    static constexpr std::int64_t noCycle = std::numeric_limits<std::int64_t>::min();
+
+    void clear() {
+        for (auto& keys : heldKeys) {
+            keys.clear();
+        }
+        for (auto& expansion : expansions) {
+            expansion.clear();
+        }
+        for (auto& sequence : sequences) {
+            sequence.invalidate();
+        }
+        anchorStep.fill(0);
+        invalidateShuffles();
+        heldMask = 0;
+    }
+
+    /** Calls fn(lane) for every lane whose bit is set in mask, lowest first. */
+    template <typename Fn>
+    static void forEach(std::uint32_t mask, Fn&& fn) {
+        while (mask != 0) {
+            fn(std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    static std::uint32_t bitFor(int lane) { return std::uint32_t(1) << lane; }
+
+    /** Makes every Random lane reshuffle at its next step. */
+    void invalidateShuffles() { shuffledCycle.fill(noCycle); }
+
+    std::array<HeldNoteSet, maxLanes> heldKeys;
+    std::array<NoteExpansion, maxLanes> expansions;  // what the keys play, with Delta/Offsets
+    std::array<StepSequence, maxLanes> sequences;
+
+    // The grid step each lane's pattern counts from; see getArpStep().
+    std::array<std::int64_t, maxLanes> anchorStep{};
+    // Which cycle the lane's Random table is currently shuffled for.
+    std::array<std::int64_t, maxLanes> shuffledCycle{};
+
+    std::uint32_t heldMask = 0;
+};
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    ArpMetrics.cpp
+
+    Lock-free processBlock instrumentation, exported through shared memory.
+
+  ==============================================================================
+*/
+
+#include "ArpMetrics.h"
+
+#include <bit>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+ #define HARPY_SHARED_METRICS 1
+#else
+ #define HARPY_SHARED_METRICS 0
+#endif
+
+namespace {
+    template <typename Int>
+    int log2Bucket(Int value)
+    {
+        return int(std::bit_width(std::make_unsigned_t<Int>(juce::jmax(Int(0), value))));
+    }
+
+    void addTo(std::atomic<juce::uint64>& counter, juce::uint64 amount)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+}
+
+namespace ArpMetrics {
+
+void InstanceMetrics::clear() noexcept
+{
+    for (auto* counter : { &blocks, &overruns, &emittedEvents, &droppedEvents, &filteredEvents,
+                           &strayNoteOffs, &lateOffsets, &clampedOffsets, &worstBlockMicros }) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+
+    blockMicros.clear();
+    deadlineLoad.clear();
+    heldNotes.clear();
+    eventsPerBlock.clear();
+    lastUpdateMs.store(0, std::memory_order_relaxed);
+}
+
+//==============================================================================
+SharedSegment::SharedSegment()
+{
+   #if HARPY_SHARED_METRICS
+    // Every copy of the plugin binary in the process (a VST3 and an AU, two
+    // versions side by side) has its own segment, told apart by a random
+    // token. O_EXCL makes sure the object is ours, so only objects this
+    // copy created are ever unlinked; a clash just draws another token.
+    constexpr int maxAttempts = 4;
+
+    for (int attempt = 0; attempt < maxAttempts && mapped == nullptr; ++attempt) {
+        auto token = juce::String::toHexString(juce::Random::getSystemRandom().nextInt()).paddedLeft('0', 8);
+        name = "/hARPy-metrics." + juce::String(int(getpid())) + "." + token;
+
+        auto fd = shm_open(name.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            if (errno == EEXIST) {
+                continue;
+            }
+            break;
+        }
+
+        if (ftruncate(fd, sizeof(SegmentLayout)) == 0) {
+            auto* memory = mmap(nullptr, sizeof(SegmentLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory != MAP_FAILED) {
+                mapped = new (memory) SegmentLayout();
+            }
+        }
+        close(fd);
+
+        if (mapped == nullptr) {
+            shm_unlink(name.toRawUTF8());
+            break;
+        }
+    }
+   #endif
+
+    if (mapped != nullptr) {
+        layout = mapped;
+    }
+    else {
+        local = std::make_unique<SegmentLayout>();
+        layout = local.get();
+        name.clear();
+    }
+}
+
+SharedSegment::~SharedSegment()
+{
+   #if HARPY_SHARED_METRICS
+    if (mapped != nullptr) {
+        mapped->~SegmentLayout();
+        munmap(mapped, sizeof(SegmentLayout));
+        shm_unlink(name.toRawUTF8());
+    }
+   #endif
+}
+
+InstanceMetrics* SharedSegment::acquireSlot()
+{
+    for (auto& slot : layout->slots) {
+        auto expected = SlotState::Free;
+        if (slot.state.load(std::memory_order_relaxed) == SlotState::Free
+            && slot.state.compare_exchange_strong(expected, SlotState::Active, std::memory_order_acquire)) {
+            slot.clear();
+            slot.instanceId.store(nextInstanceId++, std::memory_order_release);
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+void SharedSegment::releaseSlot(InstanceMetrics* slot)
+{
+    jassert(slot != nullptr);
+    slot->instanceId.store(0, std::memory_order_relaxed);
+    slot->state.store(SlotState::Free, std::memory_order_release);
+}
+
+}
+
+//==============================================================================
+ArpMetricsRecorder::ArpMetricsRecorder()
+{
+    slot = segment->acquireSlot();
+
+    if (slot == nullptr) {
+        unshared = std::make_unique<ArpMetrics::InstanceMetrics>();
+        slot = unshared.get();
+    }
+
+    prepare(44100.0, 0);
+}
+
+ArpMetricsRecorder::~ArpMetricsRecorder()
+{
+    if (unshared == nullptr) {
+        segment->releaseSlot(slot);
+    }
+}
+
+void ArpMetricsRecorder::prepare(double sampleRate, int maxBlockSize)
+{
+    auto ticksPerSecond = double(juce::Time::getHighResolutionTicksPerSecond());
+    ticksPerSample = ticksPerSecond / sampleRate;
+    ticksPerMicro = ticksPerSecond * 1.0e-6;
+
+    slot->sampleRate.store(juce::uint32(sampleRate), std::memory_order_relaxed);
+    slot->maxBlockSize.store(juce::uint32(juce::jmax(0, maxBlockSize)), std::memory_order_relaxed);
+}
+
+void ArpMetricsRecorder::beginBlock() noexcept
+{
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+    dropped = 0;
+    filtered = 0;
+    stray = 0;
+    late = 0;
+    clamped = 0;
+}
+
+void ArpMetricsRecorder::endBlock(int numSamples, int numHeldNotes, int numEmittedEvents) noexcept
+{
+    auto elapsed = juce::Time::getHighResolutionTicks() - blockStartTicks;
+    auto micros = juce::int64(double(elapsed) / ticksPerMicro);
+    auto deadline = double(numSamples) * ticksPerSample;
+    auto load = deadline > 0.0 ? double(elapsed) / deadline : 0.0;
+    auto& metrics = *slot;
+
+    metrics.blockMicros.add(log2Bucket(micros));
+    metrics.deadlineLoad.add(juce::jmin(20, int(load * 20.0)));
+    metrics.heldNotes.add(log2Bucket(numHeldNotes));
+    metrics.eventsPerBlock.add(log2Bucket(numEmittedEvents));
+
+    addTo(metrics.blocks, 1);
+    addTo(metrics.emittedEvents, juce::uint64(numEmittedEvents));
+    addTo(metrics.droppedEvents, juce::uint64(dropped));
+    addTo(metrics.filteredEvents, juce::uint64(filtered));
+    addTo(metrics.strayNoteOffs, juce::uint64(stray));
+    addTo(metrics.lateOffsets, juce::uint64(late));
+    addTo(metrics.clampedOffsets, juce::uint64(clamped));
+
+    if (load >= 1.0) {
+        addTo(metrics.overruns, 1);
+    }
+    if (juce::uint64(micros) > metrics.worstBlockMicros.load(std::memory_order_relaxed)) {
+        metrics.worstBlockMicros.store(juce::uint64(micros), std::memory_order_relaxed);
+    }
+
+    metrics.lastUpdateMs.store(juce::Time::getMillisecondCounter(), std::memory_order_release);
+}
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    ArpMetrics.h
+
+    Lock-free processBlock instrumentation, exported through shared memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace ArpMetrics {
+
+constexpr juce::uint32 segmentMagic = 0x50524168; // "hARP"
+constexpr juce::uint32 layoutVersion = 3;
+constexpr int maxInstances = 64;
+
+static_assert(std::atomic<juce::uint32>::is_always_lock_free
+              && std::atomic<juce::uint64>::is_always_lock_free,
+              "Metrics live in shared memory and need address-free atomics");
+
+//==============================================================================
+/**
+    Event counts per bucket. Each instance's histograms have a single writer,
+    the audio thread, so adding is a relaxed load and store rather than a
+    read-modify-write; readers in other processes may see a count one behind.
+*/
+template <int NumBuckets>
+struct Histogram {
+    static constexpr int numBuckets = NumBuckets;
+
+    void add(int bucket) noexcept {
+        auto& count = counts[juce::jlimit(0, numBuckets - 1, bucket)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear() noexcept {
+        for (auto& count : counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::array<std::atomic<juce::uint64>, NumBuckets> counts{};
+};
+
+enum class SlotState : juce::uint32 {
+    Free,
+    Active,
+};
+
+//==============================================================================
+/**
+    Metrics of one processor instance.
+
+    Bucket i of the log2 histograms counts values v with bit_width(v) == i,
+    i.e. bucket 0 holds 0, bucket 1 holds 1, bucket 2 holds 2..3 and so on;
+    the last bucket also takes everything larger. Deadline load is the block's
+    processing time over its duration in 5% steps, the last bucket being
+    overruns.
+*/
+struct InstanceMetrics {
+    std::atomic<SlotState> state{ SlotState::Free };
+    std::atomic<juce::uint32> instanceId{ 0 };
+    std::atomic<juce::uint32> sampleRate{ 0 };
+    std::atomic<juce::uint32> maxBlockSize{ 0 };
+    std::atomic<juce::uint32> lastUpdateMs{ 0 };
+
+    std::atomic<juce::uint64> blocks{ 0 };
+    std::atomic<juce::uint64> overruns{ 0 };
+    std::atomic<juce::uint64> emittedEvents{ 0 };
+    std::atomic<juce::uint64> droppedEvents{ 0 };
+    std::atomic<juce::uint64> filteredEvents{ 0 };  // input kept back by a Pass switch
+    std::atomic<juce::uint64> strayNoteOffs{ 0 };   // input note-offs for notes that weren't held
+    std::atomic<juce::uint64> lateOffsets{ 0 };
+    std::atomic<juce::uint64> clampedOffsets{ 0 };
+    std::atomic<juce::uint64> worstBlockMicros{ 0 };
+
+    Histogram<21> blockMicros;     // log2 of microseconds
+    Histogram<21> deadlineLoad;    // 0-5%, 5-10%, ... 95-100%, overrun
+    Histogram<9> heldNotes;        // log2, up to 128
+    Histogram<12> eventsPerBlock;  // log2
+
+    void clear() noexcept;
+};
+
+/** Everything in the segment, headed by enough to check a reader's layout. */
+struct SegmentLayout {
+    juce::uint32 magic = segmentMagic;
+    juce::uint32 version = layoutVersion;
+    juce::uint32 numSlots = maxInstances;
+    juce::uint32 slotSize = sizeof(InstanceMetrics);
+    std::array<InstanceMetrics, maxInstances> slots;
+};
+
+//==============================================================================
+/**
+    The per-process table of instance slots.
+
+    On POSIX systems it lives in a shared memory object named
+    "/hARPy-metrics.<pid>.<token>", so a monitoring tool can map it read-only
+    and walk the active slots of every hARPy instance in that process. Each
+    copy of the plugin binary loaded in a process has its own segment, with
+    a random 8-digit hex token. Elsewhere, or when the object can't be
+    created, the table stays in process memory.
+
+    Held through juce::SharedResourcePointer, so the segment is created with
+    the first instance of this binary and unlinked after the last one is
+    gone. Objects it didn't create are never unlinked.
+*/
+class SharedSegment {
+public:
+    SharedSegment();
+    ~SharedSegment();
+
+    /** Claims a free slot, or returns nullptr when all are taken. */
+    InstanceMetrics* acquireSlot();
+    void releaseSlot(InstanceMetrics* slot);
+
+    bool isShared() const { return mapped != nullptr; }
+    const juce::String& getName() const { return name; }
+
+private:
+    SegmentLayout* layout = nullptr;
+    SegmentLayout* mapped = nullptr;
+    std::unique_ptr<SegmentLayout> local;
+    juce::String name;
+    std::atomic<juce::uint32> nextInstanceId{ 1 };
+
+    JUCE_DECLARE_NON_COPYABLE(SharedSegment)
+};
+
+}
+
+//==============================================================================
+/**
+    Records what each processBlock call cost into this instance's slot.
+
+    Counts are gathered in plain members during the block and published once
+    in endBlock(), which never allocates or locks. Instances beyond the slot
+    limit record into a private slot nobody reads.
+*/
+class ArpMetricsRecorder {
+public:
+    ArpMetricsRecorder();
+    ~ArpMetricsRecorder();
+
+    void prepare(double sampleRate, int maxBlockSize);
+
+    void beginBlock() noexcept;
+    void endBlock(int numSamples, int numHeldNotes, int numEmittedEvents) noexcept;
+
+    void countDropped(int count = 1) noexcept { dropped += count; }
+    void countFiltered(int count = 1) noexcept { filtered += count; }
+    void countStray(int count = 1) noexcept { stray += count; }
+    void countLate(int count = 1) noexcept { late += count; }
+    void countClamped(int count = 1) noexcept { clamped += count; }
+
+private:
+    juce::SharedResourcePointer<ArpMetrics::SharedSegment> segment;
+    ArpMetrics::InstanceMetrics* slot = nullptr;
+    std::unique_ptr<ArpMetrics::InstanceMetrics> unshared;
+
+    double ticksPerSample = 0.0;
+    double ticksPerMicro = 0.0;
+    juce::int64 blockStartTicks = 0;
+    int dropped = 0;
+    int filtered = 0;
+    int stray = 0;
+    int late = 0;
+    int clamped = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(ArpMetricsRecorder)
+};
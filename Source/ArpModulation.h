@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    ArpModulation.h
+
+    Per-step modulation lanes: velocity, gate, transpose and probability.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+//==============================================================================
+/**
+    The modulation lanes as the user edits and saves them: for each target a
+    length of 1 to maxLength steps and that many plain values. Each lane
+    loops on its own length, so lanes of different lengths run polyrhythmically
+    against each other and against the note order.
+*/
+struct ArpModulationPattern {
+    enum Target {
+        Velocity,     // scales the velocity, 0..1
+        Gate,         // scales Note Length
+        Transpose,    // semitones
+        Probability,  // chance that the step plays at all, 0..1
+        numTargets
+    };
+
+    struct Spec {
+        const char* name;
+        float min;
+        float max;
+        float def;
+    };
+
+    static constexpr int maxLength = 64;
+
+    static constexpr std::array<Spec, numTargets> specs{ {
+        { "Velocity", 0.f, 1.f, 1.f },
+        { "Gate", 0.05f, 2.f, 1.f },
+        { "Transpose", -24.f, 24.f, 0.f },
+        { "Probability", 0.f, 1.f, 1.f },
+    } };
+
+    static float clampValue(int target, float value) {
+        const auto& spec = specs[std::size_t(target)];
+        return std::isfinite(value) ? std::clamp(value, spec.min, spec.max) : spec.def;
+    }
+
+    static int clampLength(int length) { return std::clamp(length, 1, maxLength); }
+
+    /** One step of every lane, at the neutral value. */
+    static ArpModulationPattern getDefault() {
+        ArpModulationPattern pattern;
+        for (int target = 0; target < numTargets; ++target) {
+            pattern.lengths[std::size_t(target)] = 1;
+            pattern.values[std::size_t(target)].fill(specs[std::size_t(target)].def);
+        }
+        return pattern;
+    }
+
+    std::array<int, numTargets> lengths{};
+    std::array<std::array<float, maxLength>, numTargets> values{};
+};
+
+//==============================================================================
+/**
+    The lanes compiled into flat per-target lookup tables for the engine.
+
+    Compiling clamps every value and converts it to the form a step uses
+    (a velocity factor, a gate factor, whole semitones, a 32-bit threshold for
+    the probability draw). It only happens when the lanes are edited; a step
+    then costs one lookup per target, however long or many the lanes are.
+*/
+class ArpModulation {
+public:
+    /** What the lanes do to one step. */
+    struct Step {
+        float velocity;
+        float gate;
+        int transpose;
+        std::uint64_t chance;  // the step plays if a 32-bit draw is below this
+
+        bool isCertain() const { return chance > 0xffffffffULL; }
+        bool plays(std::uint32_t draw) const { return std::uint64_t(draw) < chance; }
+    };
+
+    ArpModulation() : ArpModulation(ArpModulationPattern::getDefault()) {}
+
+    explicit ArpModulation(const ArpModulationPattern& pattern) {
+        for (int target = 0; target < ArpModulationPattern::numTargets; ++target) {
+            lengths[std::size_t(target)] = ArpModulationPattern::clampLength(pattern.lengths[std::size_t(target)]);
+        }
+
+        for (std::size_t i = 0; i < ArpModulationPattern::maxLength; ++i) {
+            auto value = [&pattern, i](int target) {
+                return ArpModulationPattern::clampValue(target, pattern.values[std::size_t(target)][i]);
+            };
+
+            velocity[i] = value(ArpModulationPattern::Velocity);
+            gate[i] = value(ArpModulationPattern::Gate);
+            transpose[i] = std::int8_t(std::lround(value(ArpModulationPattern::Transpose)));
+            chance[i] = std::uint64_t(double(value(ArpModulationPattern::Probability)) * 4294967296.0);
+        }
+    }
+
+    /** The lanes at `step`, counted from where the pattern started; negative
+        steps count back from the end of each lane. */
+    Step getStep(std::int64_t step) const {
+        return { velocity[indexFor(ArpModulationPattern::Velocity, step)],
+                 gate[indexFor(ArpModulationPattern::Gate, step)],
+                 transpose[indexFor(ArpModulationPattern::Transpose, step)],
+                 chance[indexFor(ArpModulationPattern::Probability, step)] };
+    }
+
+private:
+    std::size_t indexFor(int target, std::int64_t step) const {
+        auto length = std::int64_t(lengths[std::size_t(target)]);
+        auto index = step % length;
+        return std::size_t(index < 0 ? index + length : index);
+    }
+
+    std::array<int, ArpModulationPattern::numTargets> lengths{};
+    std::array<float, ArpModulationPattern::maxLength> velocity{};
+    std::array<float, ArpModulationPattern::maxLength> gate{};
+    std::array<std::int8_t, ArpModulationPattern::maxLength> transpose{};
+    std::array<std::uint64_t, ArpModulationPattern::maxLength> chance{};
+};
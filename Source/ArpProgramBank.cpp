@@ -0,0 +1,303 @@
+/*
+  ==============================================================================
+
+    ArpProgramBank.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpProgramBank.h"
+
+namespace {
+    constexpr int stateMagic = 0x53524168;  // "hARS"
+
+    using ValueChanges = std::initializer_list<std::pair<Params::Index, float>>;
+
+    void writeValues(juce::OutputStream& stream, const ParameterSnapshot& values)
+    {
+        for (auto value : values) {
+            stream.writeFloat(value);
+        }
+    }
+
+    /** Reads numValues floats; ones this build doesn't know are skipped, and
+        ones the data doesn't have keep their defaults. */
+    void readValues(juce::InputStream& stream, int numValues, ParameterSnapshot& values)
+    {
+        values = ArpProgramBank::getDefaultValues();
+
+        for (int i = 0; i < numValues; ++i) {
+            auto value = stream.readFloat();
+            if (i < Params::numParams) {
+                values[std::size_t(i)] = value;
+            }
+        }
+    }
+
+    bool isSameProgram(const ArpProgram& a, const ArpProgram& b)
+    {
+        return a.name == b.name && a.values == b.values;
+    }
+}
+
+//==============================================================================
+void applyParameter(ArpeggiatorSettings& settings, Params::Index index, float value)
+{
+    switch (index) {
+    case Params::Rate:
+        settings.rate = value;
+        break;
+    case Params::RateType:
+        settings.rateType = RateType(int(value));
+        break;
+    case Params::Order:
+        settings.order = ArpeggioOrder(int(value));
+        break;
+    case Params::VelFineCtrl:
+        settings.velFineCtrl = value;
+        break;
+    case Params::NoteLength:
+        settings.noteLength = value;
+        break;
+    case Params::NoteOverlap:
+        settings.noteOverlap = value;
+        break;
+    case Params::Repeats:
+        settings.repeats = int(value);
+        break;
+    case Params::Delta:
+        settings.delta = int(value);
+        break;
+    case Params::Offsets:
+        settings.offsets = int(value);
+        break;
+    case Params::Seed:
+        settings.seed = int(value);
+        break;
+    case Params::ChannelMode:
+        settings.perChannel = int(value) == 1;
+        break;
+    case Params::SidechainVelocity:
+        settings.sidechainVelocity = value;
+        break;
+    case Params::SidechainGate:
+        settings.sidechainGate = value;
+        break;
+    case Params::StepsOnOnsets:
+        settings.stepsOnOnsets = value >= 0.5f;
+        break;
+    case Params::Transpose:
+        settings.transform.transpose = int(value);
+        break;
+    case Params::Scale:
+        settings.transform.scale = int(value);
+        break;
+    case Params::Key:
+        settings.transform.key = int(value);
+        break;
+    case Params::LowNote:
+        settings.transform.lowNote = int(value);
+        break;
+    case Params::HighNote:
+        settings.transform.highNote = int(value);
+        break;
+    case Params::RangeMode:
+        settings.transform.rangeMode = NoteRangeMode(int(value));
+        break;
+    case Params::VelocityCurve:
+        settings.transform.velocityCurve = value;
+        break;
+    case Params::MaxVoices:
+        settings.maxVoices = int(value);
+        break;
+    case Params::VoiceStealing:
+        settings.stealMode = VoiceLimiter::StealMode(int(value));
+        break;
+    // MIDI routing, key zones and sidechain analysis are the processor's
+    // business, not the engine's.
+    default:
+        break;
+    }
+}
+
+//==============================================================================
+void ArpProgram::setName(const juce::String& newName)
+{
+    // Cut on a character boundary, so the stored name stays valid UTF-8.
+    auto trimmed = newName;
+    while (trimmed.getNumBytesAsUTF8() > std::size_t(maxNameLength)) {
+        trimmed = trimmed.dropLastCharacters(1);
+    }
+
+    name.fill(0);
+    std::memcpy(name.data(), trimmed.toRawUTF8(), trimmed.getNumBytesAsUTF8());
+}
+
+void ArpProgram::setValues(const ParameterSnapshot& newValues)
+{
+    settings = {};
+
+    for (const auto& spec : Params::specs) {
+        auto value = newValues[spec.index];
+        values[spec.index] = std::isfinite(value) ? juce::jlimit(spec.min, spec.max, value) : spec.def;
+        applyParameter(settings, spec.index, values[spec.index]);
+    }
+}
+
+//==============================================================================
+ArpProgramBank::ArpProgramBank()
+{
+    int numFactoryPrograms = 0;
+    auto add = [&](const char* name, ValueChanges changes) {
+        auto values = getDefaultValues();
+        for (const auto& [index, value] : changes) {
+            values[index] = value;
+        }
+
+        auto& program = programs[std::size_t(numFactoryPrograms++)];
+        program.setName(name);
+        program.setValues(values);
+    };
+
+    add("Init", {});
+    add("Sixteenths Up", { { Params::Rate, 4.f } });
+    add("Dotted Eighths Down", { { Params::RateType, 2.f }, { Params::Order, float(Down) } });
+    add("Triplet Up/Down", { { Params::Rate, 4.f }, { Params::RateType, 1.f }, { Params::Order, float(UpDown) } });
+    add("Random Octaves", { { Params::Rate, 4.f }, { Params::Order, float(Random) }, { Params::Delta, 12.f }, { Params::Offsets, 2.f } });
+    add("Chord Stabs", { { Params::Order, float(ChordRepeat) }, { Params::NoteLength, 0.25f } });
+    add("Converge Legato", { { Params::Rate, 4.f }, { Params::Order, float(Converge) }, { Params::NoteLength, 1.f } });
+    add("Diverge Doubles", { { Params::Rate, 5.f }, { Params::Order, float(Diverge) }, { Params::Repeats, 1.f } });
+    add("Per Channel", { { Params::Rate, 4.f }, { Params::ChannelMode, 1.f } });
+
+    while (numFactoryPrograms < numPrograms) {
+        add("Init", {});
+    }
+}
+
+ParameterSnapshot ArpProgramBank::getDefaultValues()
+{
+    ParameterSnapshot values{};
+    for (const auto& spec : Params::specs) {
+        values[spec.index] = spec.def;
+    }
+    return values;
+}
+
+void ArpProgramBank::write(juce::OutputStream& stream, const ArpSessionState& session) const
+{
+    // Factory programs are left out, so the usual state is a few dozen bytes.
+    static const ArpProgramBank factory;
+
+    int numChanged = 0;
+    for (int i = 0; i < numPrograms; ++i) {
+        numChanged += isSameProgram(programs[std::size_t(i)], factory[i]) ? 0 : 1;
+    }
+
+    stream.writeInt(stateMagic);
+    stream.writeShort(short(formatVersion));
+    stream.writeShort(short(Params::numParams));
+    stream.writeShort(short(session.program));
+    writeValues(stream, session.values);
+    stream.writeShort(short(numChanged));
+
+    for (int i = 0; i < numPrograms; ++i) {
+        const auto& program = programs[std::size_t(i)];
+        if (isSameProgram(program, factory[i])) {
+            continue;
+        }
+
+        auto nameLength = std::strlen(program.name.data());
+        stream.writeByte(char(i));
+        stream.writeByte(char(nameLength));
+        stream.write(program.name.data(), nameLength);
+        writeValues(stream, program.values);
+    }
+
+    stream.writeShort(short(ArpModulationPattern::numTargets));
+    for (int target = 0; target < ArpModulationPattern::numTargets; ++target) {
+        auto length = ArpModulationPattern::clampLength(session.modulation.lengths[std::size_t(target)]);
+        stream.writeByte(char(length));
+        for (int step = 0; step < length; ++step) {
+            stream.writeFloat(session.modulation.values[std::size_t(target)][std::size_t(step)]);
+        }
+    }
+}
+
+bool ArpProgramBank::read(juce::InputStream& stream, ArpSessionState& session)
+{
+    auto hasBytes = [&stream](juce::int64 numBytes) { return stream.getNumBytesRemaining() >= numBytes; };
+
+    if (!hasBytes(10) || stream.readInt() != stateMagic) {
+        return false;
+    }
+
+    auto version = int(stream.readShort());
+    auto numValues = int(juce::uint16(stream.readShort()));
+    auto program = int(stream.readShort());
+    auto valuesSize = juce::int64(numValues) * 4;
+
+    if (version < 1 || version > formatVersion || !hasBytes(valuesSize + 2)) {
+        return false;
+    }
+
+    ParameterSnapshot values;
+    readValues(stream, numValues, values);
+
+    // Programs the state leaves out are factory ones. Decode into a copy,
+    // so a truncated state changes nothing.
+    ArpProgramBank bank;
+    auto numChanged = int(stream.readShort());
+
+    for (int i = 0; i < numChanged; ++i) {
+        if (!hasBytes(2)) {
+            return false;
+        }
+
+        auto index = int(juce::uint8(stream.readByte()));
+        auto nameLength = int(juce::uint8(stream.readByte()));
+        if (index >= numPrograms || nameLength > ArpProgram::maxNameLength || !hasBytes(nameLength + valuesSize)) {
+            return false;
+        }
+
+        std::array<char, ArpProgram::maxNameLength + 1> name{};
+        stream.read(name.data(), nameLength);
+
+        ParameterSnapshot programValues;
+        readValues(stream, numValues, programValues);
+
+        bank[index].setName(juce::String::fromUTF8(name.data(), nameLength));
+        bank[index].setValues(programValues);
+    }
+
+    auto modulation = ArpModulationPattern::getDefault();
+
+    if (version >= 2) {
+        if (!hasBytes(2)) {
+            return false;
+        }
+
+        auto numLanes = int(stream.readShort());
+        for (int target = 0; target < numLanes; ++target) {
+            auto length = hasBytes(1) ? int(juce::uint8(stream.readByte())) : 0;
+            if (length < 1 || length > ArpModulationPattern::maxLength || !hasBytes(juce::int64(length) * 4)) {
+                return false;
+            }
+
+            for (int step = 0; step < length; ++step) {
+                auto value = stream.readFloat();
+                if (target < ArpModulationPattern::numTargets) {
+                    modulation.values[std::size_t(target)][std::size_t(step)] = ArpModulationPattern::clampValue(target, value);
+                }
+            }
+            if (target < ArpModulationPattern::numTargets) {
+                modulation.lengths[std::size_t(target)] = length;
+            }
+        }
+    }
+
+    *this = bank;
+    session.values = values;
+    session.program = juce::jlimit(0, numPrograms - 1, program);
+    session.modulation = modulation;
+    return true;
+}
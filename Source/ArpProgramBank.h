@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    ArpProgramBank.h
+
+    hARPy's programs, and the compact binary form the host saves them in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ArpEngine.h"
+#include "ArpModulation.h"
+#include "Parameters.h"
+
+#include <array>
+
+/** Plain values of every parameter, in Params::Index order. */
+using ParameterSnapshot = std::array<float, Params::numParams>;
+
+/** Stores one parameter's plain value in the matching field of settings. */
+void applyParameter(ArpeggiatorSettings& settings, Params::Index index, float value);
+
+//==============================================================================
+/**
+    One preset: its name, its parameter values, and the same values already
+    decoded into the settings the engine runs with, so switching to it on the
+    audio thread is a plain copy.
+*/
+struct ArpProgram {
+    static constexpr int maxNameLength = 31;  // in UTF-8 bytes
+
+    juce::String getName() const { return juce::String::fromUTF8(name.data()); }
+    void setName(const juce::String& newName);
+
+    /** Clamps the values to their ranges and decodes them into settings. */
+    void setValues(const ParameterSnapshot& newValues);
+
+    std::array<char, maxNameLength + 1> name{};
+    ParameterSnapshot values{};
+    ArpeggiatorSettings settings;
+};
+
+//==============================================================================
+/** What the host saves besides the programs. */
+struct ArpSessionState {
+    ParameterSnapshot values{};
+    int program = 0;
+    ArpModulationPattern modulation = ArpModulationPattern::getDefault();
+};
+
+//==============================================================================
+/**
+    The plugin's programs, starting out as the factory set.
+
+    write() and read() handle the plugin state as the host stores it: the
+    session state and whichever programs differ from the factory set, all in
+    a small versioned binary format:
+
+        int32   magic ('hARS')
+        int16   format version
+        int16   number of values in each snapshot (N)
+        int16   current program
+        float   current values [N]
+        int16   number of programs that follow
+                per program: uint8 index, uint8 name length, UTF-8 name,
+                             float values [N]
+        int16   number of modulation lanes that follow (version 2)
+                per lane: uint8 length, float values [length]
+
+    Values are stored in Params::Index order and lanes in Target order, so a
+    session saved before a parameter or a lane was added simply leaves it at
+    its default. Everything is little-endian, as written by
+    juce::OutputStream.
+*/
+class ArpProgramBank {
+public:
+    static constexpr int numPrograms = 16;
+    static constexpr int formatVersion = 2;
+
+    ArpProgramBank();
+
+    ArpProgram& operator[](int index) { return programs[std::size_t(index)]; }
+    const ArpProgram& operator[](int index) const { return programs[std::size_t(index)]; }
+
+    void write(juce::OutputStream& stream, const ArpSessionState& session) const;
+
+    /** Reads what write() wrote, programs it left out being factory ones.
+        Returns false, leaving everything as it was, if the data is in some
+        other format or cut short. */
+    bool read(juce::InputStream& stream, ArpSessionState& session);
+
+    static ParameterSnapshot getDefaultValues();
+
+private:
+    std::array<ArpProgram, numPrograms> programs;
+};
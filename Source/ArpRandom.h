@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    ArpRandom.h
+
+    Small seedable random number generator for the Random order.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+//==============================================================================
+/**
+    PCG32 generator (O'Neill, pcg-random.org): 64 bits of state, a handful of
+    instructions per number and fully determined by its seed, so two renders
+    with the same Seed and transport position produce the same notes.
+*/
+class ArpRandom {
+public:
+    /** Restarts the sequence for a seed and a position, e.g. a step index. */
+    void seed(std::uint32_t seedValue, std::int64_t position) {
+        state = 0;
+        increment = (mix(seedValue) << 1) | 1;
+        next();
+        state += mix(std::uint64_t(seedValue) ^ mix(std::uint64_t(position)));
+        next();
+    }
+
+    std::uint32_t next() {
+        auto oldState = state;
+        state = oldState * 6364136223846793005ULL + increment;
+        auto xorShifted = std::uint32_t(((oldState >> 18) ^ oldState) >> 27);
+        auto rotation = std::uint32_t(oldState >> 59);
+        return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+    }
+
+    /** Returns a number in [0, maxValue) without a division. */
+    int nextInt(int maxValue) {
+        assert(maxValue > 0);
+        return int((std::uint64_t(next()) * std::uint64_t(maxValue)) >> 32);
+    }
+
+private:
+    // SplitMix64 finaliser, spreads nearby seeds and positions apart.
+    static std::uint64_t mix(std::uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    std::uint64_t state = 0x853c49e6748fea9bULL;
+    std::uint64_t increment = 0xda3e39cb94b95bdbULL;
+};
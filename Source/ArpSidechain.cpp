@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    ArpSidechain.cpp
+
+    Envelope follower and onset detector for the audio sidechain, in plain
+    C++ with no dependency on JUCE.
+
+  ==============================================================================
+*/
+
+#include "ArpSidechain.h"
+
+#include <cmath>
+#include <numeric>
+#include <type_traits>
+
+namespace {
+    constexpr float floorDb = -48.f;     // maps to level 0
+    constexpr double holdOffMs = 30.0;  // shortest time between onsets
+    constexpr int maxPreparedBlock = 8192;
+
+    float toDb(float gain)
+    {
+        return 20.f * std::log10(std::max(gain, 1.0e-10f));
+    }
+}
+
+void ArpSidechain::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    holdOffSamples = int(holdOffMs * 0.001 * sampleRate);
+
+    // Hosts now and then send a longer block than they said; the envelope
+    // just holds its last value past the end.
+    auto maxHops = (std::max(maximumBlockSize, maxPreparedBlock) + ArpSidechainBlock::hopSize - 1) / ArpSidechainBlock::hopSize;
+    levels.assign(std::size_t(maxHops), 0.f);
+
+    reset();
+}
+
+void ArpSidechain::reset()
+{
+    envelopeDb = -200.f;
+    samplesSinceOnset = holdOffSamples;
+    numHops = 0;
+    numOnsets = 0;
+}
+
+void ArpSidechain::setParameters(Detector newDetector, float releaseMs, float newThresholdDb)
+{
+    detector = newDetector;
+    thresholdDb = newThresholdDb;
+
+    // The envelope falls by 60 dB over the release time, a fixed number of
+    // decibels per hop.
+    auto releaseHops = std::max(double(releaseMs) * 0.001 * sampleRate / ArpSidechainBlock::hopSize, 1.0);
+    releaseCoefficient = float(60.0 / releaseHops);
+}
+
+void ArpSidechain::process(const float* const* channels, int numChannels, int numSamples)
+{
+    numHops = 0;
+    numOnsets = 0;
+
+    if (channels == nullptr || numChannels <= 0) {
+        return;
+    }
+
+    for (int start = 0; start < numSamples && numHops < int(levels.size()); start += ArpSidechainBlock::hopSize) {
+        auto length = std::min(ArpSidechainBlock::hopSize, numSamples - start);
+        auto hopDb = toDb(measure(channels, numChannels, start, length));
+
+        if (hopDb >= envelopeDb + thresholdDb && hopDb > floorDb && samplesSinceOnset >= holdOffSamples) {
+            if (numOnsets < maxOnsets) {
+                onsets[std::size_t(numOnsets++)] = start + findOnset(channels, numChannels, start, length, envelopeDb + thresholdDb);
+            }
+            samplesSinceOnset = 0;
+        }
+        samplesSinceOnset = std::min(samplesSinceOnset + length, holdOffSamples);
+
+        envelopeDb = std::max(hopDb, envelopeDb - releaseCoefficient * float(length) / ArpSidechainBlock::hopSize);
+        levels[std::size_t(numHops++)] = std::clamp((envelopeDb - floorDb) / -floorDb, 0.f, 1.f);
+    }
+}
+
+int ArpSidechain::findOnset(const float* const* channels, int numChannels, int start, int length, float levelDb) const
+{
+    // Only runs on a hop with an onset, so a plain scan will do. With RMS
+    // no single sample may reach the level; the hop start stands in then.
+    auto gain = std::pow(10.f, levelDb / 20.f);
+
+    for (int i = 0; i < length; ++i) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            if (std::abs(channels[channel][start + i]) >= gain) {
+                return i;
+            }
+        }
+    }
+    return 0;
+}
+
+float ArpSidechain::measure(const float* const* channels, int numChannels, int start, int length) const
+{
+    std::array<float, ArpSidechainBlock::hopSize> peaks{};
+    std::array<float, ArpSidechainBlock::hopSize> squares{};
+
+    auto accumulate = [&peaks, &squares](const float* samples, auto count) {
+        for (int i = 0; i < int(count); ++i) {
+            peaks[std::size_t(i)] = std::max(peaks[std::size_t(i)], std::abs(samples[i]));
+            squares[std::size_t(i)] += samples[i] * samples[i];
+        }
+    };
+
+    // Whole hops get a loop of fixed length, which unrolls into a few SIMD
+    // operations; only the end of a block that isn't a multiple of the hop
+    // size takes the general one.
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const auto* samples = channels[channel] + start;
+        if (length == ArpSidechainBlock::hopSize) {
+            accumulate(samples, std::integral_constant<int, ArpSidechainBlock::hopSize>());
+        }
+        else {
+            accumulate(samples, length);
+        }
+    }
+
+    if (detector == Peak) {
+        return *std::max_element(peaks.begin(), peaks.end());
+    }
+
+    auto sum = std::accumulate(squares.begin(), squares.end(), 0.f);
+    return std::sqrt(sum / float(length * numChannels));
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    ArpSidechain.h
+
+    Envelope follower and onset detector for the audio sidechain, in plain
+    C++ with no dependency on JUCE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/** One block of sidechain analysis, as the engine reads it. */
+struct ArpSidechainBlock {
+    static constexpr int hopSize = 16;  // samples per envelope value
+
+    const float* levels = nullptr;        // envelope, 0..1, one per hop
+    int numHops = 0;
+    const std::int32_t* onsets = nullptr;  // sample offsets, ascending
+    int numOnsets = 0;
+
+    /** The envelope at a sample; 1 with nothing connected, so that the
+        sidechain then leaves velocity and gate alone. */
+    float getLevel(int offset) const {
+        return numHops > 0 ? levels[std::clamp(offset / hopSize, 0, numHops - 1)] : 1.f;
+    }
+};
+
+//==============================================================================
+/**
+    Follows the level of the sidechain audio and finds its onsets.
+
+    Each hop of ArpSidechainBlock::hopSize samples is measured as its peak or
+    RMS over all channels. The envelope jumps up to a louder hop at once and
+    falls back at the Release rate; it is mapped from -48..0 dBFS onto 0..1.
+    A hop that comes in Threshold dB above the envelope holds an onset,
+    placed on the first sample that gets there, unless it follows the last
+    one too closely.
+
+    Samples are measured with one accumulator per position in the hop, so
+    the inner loops carry no dependencies between iterations and compile to
+    SIMD as they are, without fast-math. Everything is sized in prepare(),
+    so analysing a block never allocates.
+*/
+class ArpSidechain {
+public:
+    enum Detector {
+        Peak,
+        Rms,
+    };
+
+    static constexpr int maxOnsets = 64;  // per block
+
+    /** Sizes the envelope for blocks of up to maximumBlockSize; allocates. */
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset();
+
+    void setParameters(Detector newDetector, float releaseMs, float thresholdDb);
+
+    /** Analyses one block. With no channels there is nothing to follow, and
+        the block's analysis is left empty. */
+    void process(const float* const* channels, int numChannels, int numSamples);
+
+    ArpSidechainBlock getBlock() const {
+        return { levels.data(), numHops, onsets.data(), numOnsets };
+    }
+
+private:
+    float measure(const float* const* channels, int numChannels, int start, int length) const;
+    int findOnset(const float* const* channels, int numChannels, int start, int length, float levelDb) const;
+
+    double sampleRate = 44100.0;
+    Detector detector = Peak;
+    float releaseCoefficient = 0.f;  // per hop
+    float thresholdDb = 9.f;
+    int holdOffSamples = 0;
+
+    float envelopeDb = -200.f;
+    int samplesSinceOnset = 0;
+
+    std::vector<float> levels;
+    int numHops = 0;
+    std::array<std::int32_t, maxOnsets> onsets{};
+    int numOnsets = 0;
+};
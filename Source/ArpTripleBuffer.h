@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    ArpTripleBuffer.h
+
+    Wait-free hand-over of a whole object to the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/**
+    Three copies of an object: one the writer fills, one the reader holds and
+    one in between.
+
+    publish() swaps the filled copy with the one in between, and acquire()
+    swaps that with the reader's, each with a single atomic exchange. Neither
+    side ever waits for the other, and neither ever touches a copy the other
+    one has, so the reader can keep references into its copy until its next
+    acquire(). If the writer publishes twice before the reader looks, the
+    reader only gets the newer one.
+
+    One writer thread and one reader thread. A copy handed back to the writer
+    holds stale data, so the writer fills in all of it before publishing.
+*/
+template <typename Object>
+class ArpTripleBuffer {
+public:
+    /** Writer: the copy to fill in. */
+    Object& getBack() noexcept { return objects[std::size_t(back)]; }
+
+    /** Writer: hands over the copy just filled in. */
+    void publish() noexcept {
+        back = middle.exchange(back | isNew, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /** Reader: takes the latest published copy, if there is one it hasn't
+        seen. Returns true if getFront() changed. */
+    bool acquire() noexcept {
+        if ((middle.load(std::memory_order_relaxed) & isNew) == 0) {
+            return false;
+        }
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    /** Reader: the copy it holds. */
+    const Object& getFront() const noexcept { return objects[std::size_t(front)]; }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int isNew = 4;
+
+    std::array<Object, 3> objects{};
+    int back = 0;
+    std::atomic<int> middle{ 1 };
+    int front = 2;
+};
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    HeldNoteSet.h
+
+    Fixed-capacity store of the notes currently held for the arpeggiator.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+//==============================================================================
+/**
+    Set of held MIDI pitches that is safe to use on the audio thread.
+
+    Presence is kept in a 128-bit mask next to per-pitch velocity and reference
+    count arrays, so adding or removing a note is O(1) and never allocates.
+    Several sources can map onto the same pitch (e.g. C4 held on two channels
+    in Omni mode); the pitch stays held until all of them are released.
+
+    The arpeggiator reads the mask directly; see NoteExpansion.
+*/
+class HeldNoteSet {
+public:
+    struct NoteVel {
+        int note;
+        std::uint8_t velocity;
+    };
+
+    static constexpr int maxNotes = 128;
+    static constexpr int maxReferences = 255;  // one per channel is 16
+
+    /** Adds one reference to a pitch. Pitches outside 0..127 are ignored. */
+    void add(int note, std::uint8_t vel) {
+        if (!isValidNote(note)) {
+            return;
+        }
+
+        if (refCounts[note] == 0) {
+            mask[note >> 6] |= bitFor(note);
+            ++numHeld;
+        }
+        if (refCounts[note] < maxReferences) {
+            ++refCounts[note];
+        }
+
+        vels[note] = vel;
+    }
+
+    /** Drops one reference to a pitch, releasing it when none are left. */
+    void remove(int note) {
+        if (!isValidNote(note) || refCounts[note] == 0) {
+            return;
+        }
+
+        if (--refCounts[note] == 0) {
+            mask[note >> 6] &= ~bitFor(note);
+            --numHeld;
+        }
+    }
+
+    void clear() {
+        mask.fill(0);
+        refCounts.fill(0);
+        numHeld = 0;
+    }
+
+    int size() const { return numHeld; }
+    bool isEmpty() const { return numHeld == 0; }
+
+    bool contains(int note) const {
+        return isValidNote(note) && refCounts[note] > 0;
+    }
+
+    /** The latest velocity of a held pitch. */
+    std::uint8_t getVelocity(int note) const {
+        assert(contains(note));
+        return vels[note];
+    }
+
+    /** Bit n of word n / 64 is set while pitch n is held. */
+    const std::array<std::uint64_t, 2>& getMask() const { return mask; }
+
+private:
+    static bool isValidNote(int note) { return unsigned(note) < unsigned(maxNotes); }
+    static std::uint64_t bitFor(int note) { return std::uint64_t(1) << (note & 63); }
+
+    std::array<std::uint64_t, 2> mask{};
+    std::array<std::uint8_t, maxNotes> vels{};
+    std::array<std::uint8_t, maxNotes> refCounts{};
+    int numHeld = 0;
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    KeyZones.h
+
+    Key and velocity zones that send each incoming note either to the
+    arpeggiator or straight through.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+/** Where an incoming note goes. */
+enum class NoteRoute : std::uint8_t {
+    Arpeggiate,
+    PassThrough,
+};
+
+//==============================================================================
+/**
+    Up to maxZones key/velocity ranges, each with a route. A note takes the
+    route of the first enabled zone it falls in, and is arpeggiated if it
+    falls in none, so with every zone off everything is arpeggiated.
+
+    The zones are compiled into a 128-entry table holding, for each key, the
+    zones that cover it. Routing a note is one lookup, plus a velocity check
+    per zone on that key when zones overlap.
+*/
+class KeyZones {
+public:
+    static constexpr int maxZones = 4;
+
+    struct Zone {
+        bool isEnabled = false;
+        NoteRoute route = NoteRoute::Arpeggiate;
+        int lowKey = 0;
+        int highKey = 127;
+        int lowVelocity = 1;
+        int highVelocity = 127;
+    };
+
+    /** Takes new zones and rebuilds the table; cheap enough for any block. */
+    void setZones(const std::array<Zone, maxZones>& newZones) {
+        zones = newZones;
+        zonesByKey.fill(0);
+
+        for (int i = 0; i < maxZones; ++i) {
+            const auto& zone = zones[std::size_t(i)];
+            if (!zone.isEnabled) {
+                continue;
+            }
+
+            for (int key = std::max(zone.lowKey, 0); key <= std::min(zone.highKey, 127); ++key) {
+                zonesByKey[std::size_t(key)] |= std::uint8_t(1 << i);
+            }
+        }
+    }
+
+    NoteRoute getRoute(int note, int velocity) const {
+        // Lowest bit first, so the first zone listed wins.
+        for (auto mask = unsigned(zonesByKey[std::size_t(note & 127)]); mask != 0; mask &= mask - 1) {
+            const auto& zone = zones[std::size_t(std::countr_zero(mask))];
+            if (velocity >= zone.lowVelocity && velocity <= zone.highVelocity) {
+                return zone.route;
+            }
+        }
+        return NoteRoute::Arpeggiate;
+    }
+
+private:
+    std::array<Zone, maxZones> zones{};
+    std::array<std::uint8_t, 128> zonesByKey{};
+};
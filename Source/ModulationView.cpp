@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    ModulationView.cpp
+
+  ==============================================================================
+*/
+
+#include "ModulationView.h"
+
+ModulationView::ModulationView(HARPyAudioProcessor& processor) :
+    audioProcessor(processor),
+    vblank(this, [this] { update(); })
+{
+    update();
+    setOpaque(true);
+}
+
+void ModulationView::update()
+{
+    auto version = audioProcessor.getModulationVersion();
+
+    if (version != shownVersion) {
+        shownVersion = version;
+        pattern = audioProcessor.getModulationPattern();
+        repaint();
+    }
+}
+
+juce::Rectangle<float> ModulationView::getRowBounds(int target) const
+{
+    auto bounds = getLocalBounds().toFloat();
+    auto rowHeight = bounds.getHeight() / float(ArpModulationPattern::numTargets);
+
+    return { bounds.getX(), bounds.getY() + float(target) * rowHeight, bounds.getWidth(), rowHeight };
+}
+
+juce::Rectangle<float> ModulationView::getStepBounds(int target, int step) const
+{
+    auto row = getRowBounds(target).withTrimmedLeft(float(labelWidth)).reduced(0.f, 2.f);
+    auto stepWidth = row.getWidth() / float(ArpModulationPattern::maxLength);
+
+    return { row.getX() + float(step) * stepWidth, row.getY(), stepWidth, row.getHeight() };
+}
+
+void ModulationView::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    g.fillAll(Colours::black);
+    g.setFont(12.f);
+
+    for (int target = 0; target < ArpModulationPattern::numTargets; ++target) {
+        const auto& spec = ArpModulationPattern::specs[size_t(target)];
+        auto length = pattern.lengths[size_t(target)];
+
+        g.setColour(Colours::white);
+        g.drawFittedText(String(spec.name) + " " + String(length),
+                         getRowBounds(target).withWidth(float(labelWidth)).reduced(4.f, 0.f).toNearestInt(),
+                         Justification::centredLeft, 1);
+
+        // Bars grow from the neutral value, so Transpose goes up and down.
+        auto toProportion = [&spec](float value) { return (value - spec.min) / (spec.max - spec.min); };
+        auto base = jlimit(0.f, 1.f, toProportion(spec.min < 0.f ? 0.f : spec.min));
+
+        for (int step = 0; step < ArpModulationPattern::maxLength; ++step) {
+            auto area = getStepBounds(target, step);
+            auto value = toProportion(pattern.values[size_t(target)][size_t(step)]);
+            auto top = area.getBottom() - area.getHeight() * jmax(value, base);
+            auto bottom = area.getBottom() - area.getHeight() * jmin(value, base);
+
+            g.setColour(Colours::white.withAlpha(step < length ? 0.8f : 0.2f));
+            g.fillRect(Rectangle<float>::leftTopRightBottom(area.getX() + 1.f, top, area.getRight(), jmax(bottom, top + 1.f)));
+        }
+    }
+}
+
+void ModulationView::mouseDown(const juce::MouseEvent& event)
+{
+    edit(event, true);
+}
+
+void ModulationView::mouseDrag(const juce::MouseEvent& event)
+{
+    edit(event, false);
+}
+
+void ModulationView::edit(const juce::MouseEvent& event, bool isStart)
+{
+    auto position = event.position;
+
+    // A drag keeps drawing into the row it started in.
+    if (isStart) {
+        editedTarget = juce::jlimit(0, ArpModulationPattern::numTargets - 1,
+                                    int(position.getY() / getRowBounds(0).getHeight()));
+        lastEditedStep = -1;
+    }
+
+    auto target = ArpModulationPattern::Target(editedTarget);
+    auto row = getStepBounds(target, 0);
+    auto step = int(std::floor((position.getX() - row.getX()) / row.getWidth()));
+
+    if (step < 0 || step >= ArpModulationPattern::maxLength) {
+        return;
+    }
+
+    if (isStart && event.mods.isShiftDown()) {
+        audioProcessor.setModulationLength(target, step + 1);
+        update();
+        return;
+    }
+
+    const auto& spec = ArpModulationPattern::specs[size_t(target)];
+    auto proportion = juce::jlimit(0.f, 1.f, (row.getBottom() - position.getY()) / row.getHeight());
+    auto value = spec.min + proportion * (spec.max - spec.min);
+    if (target == ArpModulationPattern::Transpose) {
+        value = std::round(value);
+    }
+
+    // Fast drags skip steps; fill the ones in between.
+    auto first = lastEditedStep >= 0 ? juce::jmin(lastEditedStep, step) : step;
+    auto last = lastEditedStep >= 0 ? juce::jmax(lastEditedStep, step) : step;
+    for (auto s = first; s <= last; ++s) {
+        audioProcessor.setModulationValue(target, s, value);
+    }
+    lastEditedStep = step;
+
+    update();
+}
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    ModulationView.h
+
+    Editor for the per-step modulation lanes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    One row of bars per modulation lane. Clicking or dragging across a row
+    draws its values; shift-clicking a step makes it the last one of the
+    lane. Steps beyond a lane's length are dimmed but can still be edited.
+
+    The view keeps its own copy of the lanes and only reloads it from the
+    processor when they have changed, e.g. after a session was restored.
+*/
+class ModulationView : public juce::Component {
+public:
+    explicit ModulationView(HARPyAudioProcessor& processor);
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+
+private:
+    static constexpr int labelWidth = 80;
+
+    void update();
+    void edit(const juce::MouseEvent& event, bool isStart);
+    juce::Rectangle<float> getRowBounds(int target) const;
+    juce::Rectangle<float> getStepBounds(int target, int step) const;
+
+    HARPyAudioProcessor& audioProcessor;
+    ArpModulationPattern pattern;
+    juce::uint32 shownVersion = 0;
+
+    int editedTarget = -1;
+    int lastEditedStep = -1;
+
+    juce::VBlankAttachment vblank;
+};
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    NoteExpansion.h
+
+    The Delta/Offsets copies of the held keys, worked out instead of stored.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "HeldNoteSet.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+
+//==============================================================================
+/**
+    The held keys plus Offsets copies of them, each Delta semitones beyond the
+    last, seen as one ascending sequence of pitches that is never
+    materialised.
+
+    The pitches are a 128-bit mask: the held keys' mask OR'd with itself
+    shifted by each copy's distance, so a copy landing on a held key or on
+    another copy (C3 and C4 with Delta 12) is one pitch, played once, and
+    copies beyond 0..127 simply fall off. Index i is the i-th set bit. Only
+    the real keys are held anywhere, so a new Delta or Offsets re-voices a
+    held chord at once and costs a few shifts.
+
+    A pitch plays with the velocity of the key it is a copy of; when it is a
+    copy of several, the nearest one wins, and a held key is its own.
+*/
+class NoteExpansion {
+public:
+    static constexpr int maxOffsets = 8;
+
+    void clear() {
+        mask.fill(0);
+        length = 0;
+    }
+
+    /** Recomputes the union; O(Offsets), a couple of shifts each. */
+    void update(const HeldNoteSet& keys, int newDelta, int offsets) {
+        // With no Delta every copy is the key itself, so there is just one.
+        delta = newDelta;
+        numCopies = (delta != 0) ? std::clamp(offsets, 0, maxOffsets) + 1 : 1;
+
+        mask.fill(0);
+        for (int copy = 0; copy < numCopies; ++copy) {
+            auto shifted = shift(keys.getMask(), copy * delta);
+            mask[0] |= shifted[0];
+            mask[1] |= shifted[1];
+        }
+
+        length = std::popcount(mask[0]) + std::popcount(mask[1]);
+    }
+
+    int size() const { return length; }
+    bool isEmpty() const { return length == 0; }
+
+    /** The index-th pitch of the sequence, in ascending order. */
+    HeldNoteSet::NoteVel get(const HeldNoteSet& keys, int index) const {
+        assert(index >= 0 && index < length);
+
+        auto lowCount = std::popcount(mask[0]);
+        auto word = index < lowCount ? 0 : 1;
+        auto bits = mask[std::size_t(word)];
+        for (auto skip = index - word * lowCount; skip > 0; --skip) {
+            bits &= bits - 1;
+        }
+
+        auto note = word * 64 + std::countr_zero(bits);
+        for (int copy = 0; copy < numCopies; ++copy) {
+            if (keys.contains(note - copy * delta)) {
+                return { note, keys.getVelocity(note - copy * delta) };
+            }
+        }
+
+        assert(false);
+        return { note, 0 };
+    }
+
+private:
+    using Mask = std::array<std::uint64_t, 2>;
+
+    /** Pitches moved up (or down, if negative) by `by` semitones; any that
+        end up outside 0..127 are gone. */
+    static Mask shift(const Mask& pitches, int by) {
+        if (by == 0) {
+            return pitches;
+        }
+        if (by >= 128 || by <= -128) {
+            return {};
+        }
+        if (by >= 64) {
+            return { 0, pitches[0] << (by - 64) };
+        }
+        if (by > 0) {
+            return { pitches[0] << by, (pitches[1] << by) | (pitches[0] >> (64 - by)) };
+        }
+        if (by <= -64) {
+            return { pitches[1] >> (-by - 64), 0 };
+        }
+        return { (pitches[0] >> -by) | (pitches[1] << (64 + by)), pitches[1] >> -by };
+    }
+
+    Mask mask{};
+    int delta = 0;
+    int numCopies = 1;
+    int length = 0;
+};
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    NoteOffQueue.h
+
+    Fixed-capacity schedule of the note-offs the arpeggiator still owes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+//==============================================================================
+/**
+    Min-heap of pending note-offs, keyed by absolute sample time.
+
+    Every note-on the engine emits pushes its note-off here, so a note is
+    always ended exactly once, whatever happens to the held keys, the order,
+    the gate length or the transport in the meantime. Gates may be longer
+    than a step: overlapping notes simply sit in the heap side by side.
+
+    Storage is a plain array inside the object, so pushing and popping never
+    allocate. Every (channel, note) pair has a slot holding its entry's place
+    in the heap, so "is this note still sounding?" is O(1) and ending a note
+    ahead of time, when it is retriggered or stolen, is O(log n).
+*/
+class NoteOffQueue {
+public:
+    // More notes than anything the arpeggiator drives can sound at once,
+    // and few enough that a place in the heap fits in a byte.
+    static constexpr int capacity = 128;
+
+    struct Entry {
+        std::int64_t time;
+        std::uint8_t channel;  // 1..16
+        std::uint8_t note;
+    };
+
+    void clear() {
+        numEntries = 0;
+        positions.fill(notPending);
+    }
+
+    bool isEmpty() const { return numEntries == 0; }
+    bool isFull() const { return numEntries == capacity; }
+    int size() const { return numEntries; }
+
+    /** The earliest pending note-off; the queue must not be empty. */
+    const Entry& top() const {
+        assert(numEntries > 0);
+        return entries[0];
+    }
+
+    bool contains(int channel, int note) const {
+        return positions[getKey(channel, note)] != notPending;
+    }
+
+    /** Schedules a note-off; the queue must not be full, and the note must
+        not already be pending (end it first). */
+    void push(const Entry& entry) {
+        assert(numEntries < capacity && !contains(entry.channel, entry.note));
+        place(numEntries, entry);
+        siftUp(numEntries++);
+    }
+
+    /** Removes the earliest note-off and returns it. */
+    Entry pop() {
+        auto entry = top();
+        removeAt(0);
+        return entry;
+    }
+
+    /** Removes a pending note-off ahead of time. Returns false if there was
+        none. */
+    bool remove(int channel, int note) {
+        auto position = positions[getKey(channel, note)];
+        if (position == notPending) {
+            return false;
+        }
+
+        removeAt(position);
+        return true;
+    }
+
+    const Entry* begin() const { return entries.data(); }
+    const Entry* end() const { return entries.data() + numEntries; }
+
+private:
+    static constexpr std::int8_t notPending = -1;
+
+    static std::size_t getKey(int channel, int note) { return std::size_t(((channel - 1) & 15) * 128 + (note & 127)); }
+
+    void place(int index, const Entry& entry) {
+        entries[std::size_t(index)] = entry;
+        positions[getKey(entry.channel, entry.note)] = std::int8_t(index);
+    }
+
+    void swapEntries(int a, int b) {
+        auto entry = entries[std::size_t(a)];
+        place(a, entries[std::size_t(b)]);
+        place(b, entry);
+    }
+
+    void removeAt(int index) {
+        const auto& removed = entries[std::size_t(index)];
+        positions[getKey(removed.channel, removed.note)] = notPending;
+
+        --numEntries;
+        if (index == numEntries) {
+            return;
+        }
+
+        place(index, entries[std::size_t(numEntries)]);
+        siftUp(index);
+        siftDown(index);
+    }
+
+    void siftUp(int index) {
+        while (index > 0) {
+            auto parent = (index - 1) / 2;
+            if (entries[std::size_t(parent)].time <= entries[std::size_t(index)].time) {
+                break;
+            }
+            swapEntries(parent, index);
+            index = parent;
+        }
+    }
+
+    void siftDown(int index) {
+        for (;;) {
+            auto smallest = index;
+            for (auto child : { 2 * index + 1, 2 * index + 2 }) {
+                if (child < numEntries && entries[std::size_t(child)].time < entries[std::size_t(smallest)].time) {
+                    smallest = child;
+                }
+            }
+            if (smallest == index) {
+                break;
+            }
+            swapEntries(smallest, index);
+            index = smallest;
+        }
+    }
+
+    std::array<Entry, capacity> entries{};
+    std::array<std::int8_t, 16 * 128> positions = makeEmptyPositions();
+    int numEntries = 0;
+
+    static std::array<std::int8_t, 16 * 128> makeEmptyPositions() {
+        std::array<std::int8_t, 16 * 128> empty;
+        empty.fill(notPending);
+        return empty;
+    }
+};
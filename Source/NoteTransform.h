@@ -0,0 +1,178 @@
+/*
+  ==============================================================================
+
+    NoteTransform.h
+
+    What happens to a note between being picked and being played: fixed
+    transpose, scale quantising, range folding and a velocity curve.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+enum class NoteRangeMode : std::uint8_t {
+    Drop,   // notes outside the range are left out
+    Clamp,  // ... moved to its nearest end
+    Fold,   // ... moved into it by whole octaves
+};
+
+struct NoteTransformSettings {
+    int transpose{ 0 };
+    int scale{ 0 };  // NoteTransform::scales index
+    int key{ 0 };    // 0 = C
+    int lowNote{ 0 };
+    int highNote{ 127 };
+    NoteRangeMode rangeMode{ NoteRangeMode::Drop };
+    float velocityCurve{ 0.f };  // -1..1, 0 = linear
+
+    bool operator==(const NoteTransformSettings&) const = default;
+};
+
+//==============================================================================
+/** The stages. Each maps one value to another for given settings; they are
+    only ever run while baking the tables, so they favour being obvious. */
+namespace NoteStages {
+
+constexpr int noNote = -1;
+
+struct Transpose {
+    static int apply(int note, const NoteTransformSettings& settings) { return note + settings.transpose; }
+};
+
+struct QuantiseToScale {
+    // One bit per semitone above the key.
+    static constexpr std::array<std::uint16_t, 8> masks{
+        0b111111111111,  // Chromatic
+        0b101010110101,  // Major
+        0b010110101101,  // Minor
+        0b011010101101,  // Dorian
+        0b011010110101,  // Mixolydian
+        0b001010010101,  // Major Pentatonic
+        0b010010101001,  // Minor Pentatonic
+        0b100110101101,  // Harmonic Minor
+    };
+
+    static bool isInScale(int note, std::uint16_t mask, int key) {
+        auto degree = ((note - key) % 12 + 12) % 12;
+        return (mask >> degree) & 1;
+    }
+
+    /** The nearest note in the scale; the lower one when two are as near. */
+    static int apply(int note, const NoteTransformSettings& settings) {
+        auto mask = masks[std::size_t(std::clamp(settings.scale, 0, int(masks.size()) - 1))];
+        for (int distance = 0; distance < 12; ++distance) {
+            if (isInScale(note - distance, mask, settings.key)) {
+                return note - distance;
+            }
+            if (isInScale(note + distance, mask, settings.key)) {
+                return note + distance;
+            }
+        }
+        return note;
+    }
+};
+
+struct FitRange {
+    static int apply(int note, const NoteTransformSettings& settings) {
+        auto low = std::clamp(std::min(settings.lowNote, settings.highNote), 0, 127);
+        auto high = std::clamp(std::max(settings.lowNote, settings.highNote), 0, 127);
+
+        if (note >= low && note <= high) {
+            return note;
+        }
+
+        switch (settings.rangeMode) {
+        case NoteRangeMode::Drop:
+            return noNote;
+        case NoteRangeMode::Clamp:
+            return std::clamp(note, low, high);
+        case NoteRangeMode::Fold:
+            while (note > high) {
+                note -= 12;
+            }
+            while (note < low) {
+                note += 12;
+            }
+            // A range narrower than an octave can be jumped right over.
+            return note <= high ? note : noNote;
+        }
+        return noNote;
+    }
+};
+
+struct VelocityCurve {
+    /** A power curve through 0 and 127; above 0 louder, below 0 softer. A
+        velocity that was above 0 stays above 0, so no note turns into a
+        note-off. */
+    static int apply(int velocity, const NoteTransformSettings& settings) {
+        if (velocity <= 0) {
+            return 0;
+        }
+        auto exponent = std::pow(4.f, -std::clamp(settings.velocityCurve, -1.f, 1.f));
+        auto curved = int(std::lround(127.f * std::pow(float(velocity) / 127.f, exponent)));
+        return std::clamp(curved, 1, 127);
+    }
+};
+
+/** Stages run left to right, chained at compile time. */
+template <typename... Stages>
+struct Chain {
+    static int apply(int value, const NoteTransformSettings& settings) {
+        ((value = Stages::apply(value, settings)), ...);
+        return value;
+    }
+};
+
+}
+
+//==============================================================================
+/**
+    The note and velocity pipelines, baked into lookup tables.
+
+    Whatever stages are active, playing a note costs one lookup for its
+    pitch and one for its velocity. The tables are rebaked when the settings
+    change, which takes a few microseconds.
+
+    The pitch table covers 0..127 plus a margin either side, so a note the
+    modulation lanes transposed out of range still goes through the range
+    stage instead of being lost on the way in.
+*/
+class NoteTransform {
+public:
+    using PitchStages = NoteStages::Chain<NoteStages::Transpose, NoteStages::QuantiseToScale, NoteStages::FitRange>;
+    using VelocityStages = NoteStages::Chain<NoteStages::VelocityCurve>;
+
+    static constexpr int numScales = int(NoteStages::QuantiseToScale::masks.size());
+    static constexpr int inputMargin = 24;
+
+    NoteTransform() { bake({}); }
+
+    void bake(const NoteTransformSettings& settings) {
+        for (int i = 0; i < int(pitches.size()); ++i) {
+            pitches[std::size_t(i)] = std::int16_t(PitchStages::apply(i - inputMargin, settings));
+        }
+        for (int velocity = 0; velocity < int(velocities.size()); ++velocity) {
+            velocities[std::size_t(velocity)] = std::uint8_t(VelocityStages::apply(velocity, settings));
+        }
+    }
+
+    /** The note to play, or NoteStages::noNote to play none. */
+    int getNote(int note) const {
+        auto index = note + inputMargin;
+        return (index >= 0 && index < int(pitches.size())) ? pitches[std::size_t(index)] : NoteStages::noNote;
+    }
+
+    std::uint8_t getVelocity(int velocity) const {
+        return velocities[std::size_t(std::clamp(velocity, 0, 127))];
+    }
+
+private:
+    std::array<std::int16_t, 128 + 2 * inputMargin> pitches{};
+    std::array<std::uint8_t, 128> velocities{};
+};
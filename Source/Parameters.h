@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    Parameters.h
+
+    The single table of hARPy's parameters: ID, type, range and default.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+
+namespace Params {
+
+// Hosts may address parameters by their index, so new ones only ever go at
+// the end; moving one would send saved automation to another parameter.
+enum Index {
+    Rate,
+    Order,
+    VelFineCtrl,
+    NoteLength,
+    Repeats,
+    Delta,
+    Offsets,
+    RateType,
+    Seed,
+    ChannelMode,
+    PassNotes,
+    PassControllers,
+    PassPitchBend,
+    PassAftertouch,
+    PassProgramChange,
+    PassOther,
+    Zone1Mode,
+    Zone1LowKey,
+    Zone1HighKey,
+    Zone1LowVelocity,
+    Zone1HighVelocity,
+    Zone2Mode,
+    Zone2LowKey,
+    Zone2HighKey,
+    Zone2LowVelocity,
+    Zone2HighVelocity,
+    Zone3Mode,
+    Zone3LowKey,
+    Zone3HighKey,
+    Zone3LowVelocity,
+    Zone3HighVelocity,
+    Zone4Mode,
+    Zone4LowKey,
+    Zone4HighKey,
+    Zone4LowVelocity,
+    Zone4HighVelocity,
+    SidechainDetector,
+    SidechainRelease,
+    SidechainThreshold,
+    SidechainVelocity,
+    SidechainGate,
+    StepsOnOnsets,
+    Transpose,
+    Scale,
+    Key,
+    LowNote,
+    HighNote,
+    RangeMode,
+    VelocityCurve,
+    MaxVoices,
+    VoiceStealing,
+    NoteOverlap,
+    numParams
+};
+
+enum class Type {
+    Choice,
+    Float,
+    Int,
+    Bool,
+};
+
+struct Spec {
+    Index index;
+    const char* id;
+    Type type;
+    float min;
+    float max;
+    float def;
+    const char* const* choices{ nullptr };
+};
+
+inline constexpr const char* rateChoices[] {
+    "1/1",
+    "1/2",
+    "1/4",
+    "1/8",
+    "1/16",
+    "1/32",
+    "1/64",
+};
+
+inline constexpr const char* rateTypeChoices[] {
+    "Straight",
+    "Triplet",
+    "Dotted",
+};
+
+inline constexpr const char* orderChoices[] {
+    "Up",
+    "Down",
+    "Up/Down",
+    "Down/Up",
+    "Up & Down",
+    "Down & Up",
+    "Random",
+    "Chord Repeat",
+    "Converge",
+    "Diverge",
+};
+
+inline constexpr const char* channelModeChoices[] {
+    "Omni",
+    "Per Channel",
+};
+
+inline constexpr const char* sidechainDetectorChoices[] {
+    "Peak",
+    "RMS",
+};
+
+inline constexpr const char* scaleChoices[] {
+    "Chromatic",
+    "Major",
+    "Minor",
+    "Dorian",
+    "Mixolydian",
+    "Major Pentatonic",
+    "Minor Pentatonic",
+    "Harmonic Minor",
+};
+
+inline constexpr const char* keyChoices[] {
+    "C",
+    "C#",
+    "D",
+    "D#",
+    "E",
+    "F",
+    "F#",
+    "G",
+    "G#",
+    "A",
+    "A#",
+    "B",
+};
+
+inline constexpr const char* rangeModeChoices[] {
+    "Drop",
+    "Clamp",
+    "Fold",
+};
+
+inline constexpr const char* voiceStealingChoices[] {
+    "Oldest",
+    "Quietest",
+};
+
+inline constexpr const char* zoneModeChoices[] {
+    "Off",
+    "Arpeggiate",
+    "Pass Through",
+};
+
+template <size_t N>
+constexpr Spec choice(Index index, const char* id, const char* const (&choices)[N], int def)
+{
+    return { index, id, Type::Choice, 0.f, float(N - 1), float(def), choices };
+}
+
+constexpr Spec floatParam(Index index, const char* id, float min, float max, float def)
+{
+    return { index, id, Type::Float, min, max, def };
+}
+
+constexpr Spec intParam(Index index, const char* id, int min, int max, int def)
+{
+    return { index, id, Type::Int, float(min), float(max), float(def) };
+}
+
+constexpr Spec boolParam(Index index, const char* id, bool def)
+{
+    return { index, id, Type::Bool, 0.f, 1.f, def ? 1.f : 0.f };
+}
+
+inline constexpr std::array<Spec, numParams> specs {
+    choice(Rate, "Rate", rateChoices, 3),
+    choice(Order, "Order", orderChoices, 0),
+    floatParam(VelFineCtrl, "Velocity Fine Control", 0.01f, 1.f, 1.f),
+    floatParam(NoteLength, "Note Length", 0.01f, 1.f, 0.5f),
+    intParam(Repeats, "Repeats", 0, 16, 0),
+    intParam(Delta, "Delta", -24, 24, 0),
+    intParam(Offsets, "Offsets", 0, 8, 0),
+    choice(RateType, "Rate Type", rateTypeChoices, 0),
+    intParam(Seed, "Seed", 0, 9999, 0),
+    choice(ChannelMode, "Channel Mode", channelModeChoices, 0),
+    // Whether incoming messages of each kind also go to the output. Notes
+    // and Program Changes are used by hARPy; everything else only passes.
+    boolParam(PassNotes, "Pass Notes", false),
+    boolParam(PassControllers, "Pass Controllers", true),
+    boolParam(PassPitchBend, "Pass Pitch Bend", true),
+    boolParam(PassAftertouch, "Pass Aftertouch", true),
+    boolParam(PassProgramChange, "Pass Program Change", false),
+    boolParam(PassOther, "Pass Other MIDI", true),
+    // Key/velocity zones; a note in none of them is arpeggiated.
+    choice(Zone1Mode, "Zone 1 Mode", zoneModeChoices, 0),
+    intParam(Zone1LowKey, "Zone 1 Low Key", 0, 127, 0),
+    intParam(Zone1HighKey, "Zone 1 High Key", 0, 127, 127),
+    intParam(Zone1LowVelocity, "Zone 1 Low Velocity", 1, 127, 1),
+    intParam(Zone1HighVelocity, "Zone 1 High Velocity", 1, 127, 127),
+    choice(Zone2Mode, "Zone 2 Mode", zoneModeChoices, 0),
+    intParam(Zone2LowKey, "Zone 2 Low Key", 0, 127, 0),
+    intParam(Zone2HighKey, "Zone 2 High Key", 0, 127, 127),
+    intParam(Zone2LowVelocity, "Zone 2 Low Velocity", 1, 127, 1),
+    intParam(Zone2HighVelocity, "Zone 2 High Velocity", 1, 127, 127),
+    choice(Zone3Mode, "Zone 3 Mode", zoneModeChoices, 0),
+    intParam(Zone3LowKey, "Zone 3 Low Key", 0, 127, 0),
+    intParam(Zone3HighKey, "Zone 3 High Key", 0, 127, 127),
+    intParam(Zone3LowVelocity, "Zone 3 Low Velocity", 1, 127, 1),
+    intParam(Zone3HighVelocity, "Zone 3 High Velocity", 1, 127, 127),
+    choice(Zone4Mode, "Zone 4 Mode", zoneModeChoices, 0),
+    intParam(Zone4LowKey, "Zone 4 Low Key", 0, 127, 0),
+    intParam(Zone4HighKey, "Zone 4 High Key", 0, 127, 127),
+    intParam(Zone4LowVelocity, "Zone 4 Low Velocity", 1, 127, 1),
+    intParam(Zone4HighVelocity, "Zone 4 High Velocity", 1, 127, 127),
+    // The audio sidechain: how it is followed, and what it drives.
+    choice(SidechainDetector, "Sidechain Detector", sidechainDetectorChoices, 0),
+    floatParam(SidechainRelease, "Sidechain Release", 5.f, 2000.f, 150.f),
+    floatParam(SidechainThreshold, "Sidechain Threshold", 1.f, 24.f, 9.f),
+    floatParam(SidechainVelocity, "Sidechain Velocity", 0.f, 1.f, 0.f),
+    floatParam(SidechainGate, "Sidechain Gate", 0.f, 1.f, 0.f),
+    boolParam(StepsOnOnsets, "Steps on Onsets", false),
+    // What happens to each note on its way out.
+    intParam(Transpose, "Transpose", -24, 24, 0),
+    choice(Scale, "Scale", scaleChoices, 0),
+    choice(Key, "Key", keyChoices, 0),
+    intParam(LowNote, "Low Note", 0, 127, 0),
+    intParam(HighNote, "High Note", 0, 127, 127),
+    choice(RangeMode, "Range Mode", rangeModeChoices, 0),
+    floatParam(VelocityCurve, "Velocity Curve", -1.f, 1.f, 0.f),
+    // A cap on the notes sounding at once, for whatever comes after.
+    intParam(MaxVoices, "Max Voices", 1, 128, 128),
+    choice(VoiceStealing, "Voice Stealing", voiceStealingChoices, 0),
+    // Steps a gate lasts beyond Note Length, for legato and overlap.
+    floatParam(NoteOverlap, "Note Overlap", 0.f, 3.f, 0.f),
+};
+
+constexpr bool specsMatchIndices()
+{
+    for (int i = 0; i < numParams; ++i) {
+        if (specs[i].index != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(specsMatchIndices(), "Params::specs must be listed in Params::Index order");
+
+constexpr const char* getID(Index index)
+{
+    return specs[index].id;
+}
+
+constexpr int numZoneParams = Zone2Mode - Zone1Mode;
+
+/** The given zone's counterpart of one of zone 1's parameters. */
+constexpr Index getZoneParam(int zone, Index zone1Param)
+{
+    return Index(zone1Param + zone * numZoneParams);
+}
+
+}
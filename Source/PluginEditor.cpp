@@ -19,12 +19,9 @@ void LookAndFeel::drawRotarySlider(juce::Graphics& g,
     using namespace juce;
 
     auto bounds = Rectangle<float>(x, y, width, height);
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
-    g.setColour(Colours::black);
-    g.fillEllipse(bounds);
-
-    g.setColour(Colours::white);
-    g.drawEllipse(bounds, 1.f);
+    g.drawImage(getKnobImage(width, height, scale), bounds);
 
     if (auto* rswl = dynamic_cast<RotarySliderWithLabel*>(&slider)) {
         auto center = bounds.getCentre();
@@ -45,23 +42,73 @@ void LookAndFeel::drawRotarySlider(juce::Graphics& g,
 
         p.applyTransform(AffineTransform().rotated(sliderAngRad, center.getX(), center.getY()));
 
+        g.setColour(Colours::white);
         g.fillPath(p);
 
-        g.setFont(rswl->getTextHeight());
-        auto text = rswl->getDisplayString();
-        auto strWidth = g.getCurrentFont().getStringWidth(text);
-
-        r.setSize(strWidth + 3, rswl->getTextHeight() + 3);
+        r.setSize(rswl->getDisplayStringWidth() + 3, rswl->getTextHeight() + 3);
         r.setCentre(bounds.getCentreX(), bounds.getY() + bounds.getHeight() + rswl->getTextHeight());
 
         g.setColour(Colours::black);
         g.fillRect(r);
 
         g.setColour(Colours::white);
-        g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
+        g.setFont(rswl->getTextHeight());
+        g.drawFittedText(rswl->getDisplayString(), r.toNearestInt(), juce::Justification::centred, 1);
     }
 }
+
+const juce::Image& LookAndFeel::getKnobImage(int width, int height, float scale)
+{
+    using namespace juce;
+
+    for (const auto& knob : knobCache) {
+        if (knob.width == width && knob.height == height && knob.scale == scale) {
+            return knob.image;
+        }
+    }
+
+    // Resizing a window leaves a trail of sizes nobody will draw again.
+    if (knobCache.size() >= 16) {
+        knobCache.clear();
+    }
+
+    Image image(Image::ARGB, jmax(1, roundToInt(width * scale)), jmax(1, roundToInt(height * scale)), true);
+    Graphics g(image);
+    g.addTransform(AffineTransform::scale(scale));
+
+    auto bounds = Rectangle<float>(0, 0, width, height);
+
+    g.setColour(Colours::black);
+    g.fillEllipse(bounds);
+
+    g.setColour(Colours::white);
+    g.drawEllipse(bounds, 1.f);
+
+    knobCache.push_back({ width, height, scale, image });
+    return knobCache.back().image;
+}
 //==============================================================================
+RotarySliderWithLabel::RotarySliderWithLabel(juce::RangedAudioParameter& rap, const juce::String& t, Format f, const juce::String& u) :
+    juce::Slider(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag, juce::Slider::TextEntryBoxPosition::NoTextBox),
+    choiceParam(dynamic_cast<juce::AudioParameterChoice*>(&rap)),
+    format(f),
+    title(t),
+    unit(u)
+{
+    if (format == Format::Automatic) {
+        format = (choiceParam != nullptr) ? Format::Choice
+               : (dynamic_cast<juce::AudioParameterFloat*>(&rap) != nullptr) ? Format::Percent
+               : (title == "Repeats") ? Format::Repeats
+               : Format::Integer;
+    }
+
+    jassert(format != Format::Choice || choiceParam != nullptr);
+
+    setLookAndFeel(lnf);
+    setOpaque(true);
+    valueChanged();
+}
+
 void RotarySliderWithLabel::paint(juce::Graphics& g) {
     using namespace juce;
 
@@ -96,6 +143,33 @@ void RotarySliderWithLabel::paint(juce::Graphics& g) {
     );
 }
 
+void RotarySliderWithLabel::valueChanged() {
+    // The slider repaints itself after this; all that's left is the text.
+    switch (format) {
+    case Format::Choice:
+        displayString = choiceParam->choices[juce::jlimit(0, choiceParam->choices.size() - 1, int(getValue()))];
+        break;
+    case Format::Percent:
+        displayString = juce::String(getValue() * 100.f, 0) + "%";
+        break;
+    case Format::Repeats:
+        displayString = (int(getValue()) == 0) ? juce::String("inf") : juce::String(int(getValue()));
+        break;
+    case Format::NoteName:
+        displayString = juce::MidiMessage::getMidiNoteName(int(getValue()), true, true, 3);
+        break;
+    case Format::Value:
+        displayString = juce::String(getValue(), getMaximum() - getMinimum() > 100.0 ? 0 : 1) + " " + unit;
+        break;
+    case Format::Automatic:
+    case Format::Integer:
+        displayString = juce::String(int(getValue()));
+        break;
+    }
+
+    displayStringWidth = juce::Font(juce::FontOptions(float(getTextHeight()))).getStringWidthFloat(displayString);
+}
+
 juce::Rectangle<int> RotarySliderWithLabel::getSliderBounds() const {
     auto bounds = getLocalBounds();
 
@@ -110,40 +184,76 @@ juce::Rectangle<int> RotarySliderWithLabel::getSliderBounds() const {
 
     return r;
 }
-
-juce::String RotarySliderWithLabel::getDisplayString() const {
-    if (auto* choiceParam = dynamic_cast<juce::AudioParameterChoice*>(param)) {
-        return choiceParam->getCurrentChoiceName();
+//==============================================================================
+ParameterPanel::ParameterPanel(juce::AudioProcessorValueTreeState& apvts, std::initializer_list<Control> controlsToShow)
+{
+    for (const auto& control : controlsToShow) {
+        const auto* id = Params::getID(control.index);
+
+        if (Params::specs[control.index].type == Params::Type::Bool) {
+            auto button = std::make_unique<juce::ToggleButton>(control.title);
+            button->setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+            button->setColour(juce::ToggleButton::tickColourId, juce::Colours::white);
+            buttonAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, id, *button));
+            controls.push_back(std::move(button));
+        }
+        else {
+            auto slider = std::make_unique<RotarySliderWithLabel>(*apvts.getParameter(id), control.title, control.format, control.unit);
+            sliderAttachments.push_back(std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, id, *slider));
+            controls.push_back(std::move(slider));
+        }
+
+        addAndMakeVisible(*controls.back());
     }
 
-    if (auto* floatParam = dynamic_cast<juce::AudioParameterFloat*>(param)) {
-        return juce::String(getValue() * 100.f, 0) + "%";
-    }
+    setOpaque(true);
+}
+
+void ParameterPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::darkgrey);
+}
+
+void ParameterPanel::resized()
+{
+    // Each control gets as much room as a knob of the main row, from the
+    // left, so the same kind of control lines up from tab to tab.
+    auto bounds = getLocalBounds();
+    auto width = juce::jmin(bounds.getWidth() / juce::jmax(1, int(controls.size())), 84);
 
-    if (auto* intParam = dynamic_cast<juce::AudioParameterInt*>(param)) {
-        int value = getValue();
-        return (title == "Repeats")
-            ? juce::String((value == 0) ? juce::String("inf") : juce::String(value))
-            : juce::String(value);
+    for (auto& control : controls) {
+        control->setBounds(bounds.removeFromLeft(width - 1));
+        bounds.removeFromLeft(1);
     }
 }
+
 //==============================================================================
 HARPyAudioProcessorEditor::HARPyAudioProcessorEditor (HARPyAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
-    rateSlider(*audioProcessor.apvts.getParameter("Rate"), "Rate"),
-    orderSlider(*audioProcessor.apvts.getParameter("Order"), "Order"),
-    velFineCtrlSlider(*audioProcessor.apvts.getParameter("Velocity Fine Control"), "Velocity"),
-    noteLenSlider(*audioProcessor.apvts.getParameter("Note Length"), "Note Length"),
-    repeatsSlider(*audioProcessor.apvts.getParameter("Repeats"), "Repeats"),
-    deltaSlider(*audioProcessor.apvts.getParameter("Delta"), "Delta"),
-    offsetsSlider(*audioProcessor.apvts.getParameter("Offsets"), "Offsets"),
-    rateSliderAttachment(audioProcessor.apvts, "Rate", rateSlider),
-    orderSliderAttachment(audioProcessor.apvts, "Order", orderSlider),
-    velFineCtrlSliderAttachment(audioProcessor.apvts, "Velocity Fine Control", velFineCtrlSlider),
-    noteLenSliderAttachment(audioProcessor.apvts, "Note Length", noteLenSlider),
-    repeatsSliderAttachment(audioProcessor.apvts, "Repeats", repeatsSlider),
-    deltaSliderAttachment(audioProcessor.apvts, "Delta", deltaSlider),
-    offsetsSliderAttachment(audioProcessor.apvts, "Offsets", offsetsSlider)
+    stepView(audioProcessor.display),
+    modulationView(audioProcessor),
+    rateSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::Rate)), "Rate"),
+    rateTypeSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::RateType)), "Rate Type"),
+    orderSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::Order)), "Order"),
+    velFineCtrlSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::VelFineCtrl)), "Velocity"),
+    noteLenSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::NoteLength)), "Note Length"),
+    noteOverlapSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::NoteOverlap)), "Overlap"),
+    repeatsSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::Repeats)), "Repeats"),
+    deltaSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::Delta)), "Delta"),
+    offsetsSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::Offsets)), "Offsets"),
+    seedSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::Seed)), "Seed"),
+    channelModeSlider(*audioProcessor.apvts.getParameter(Params::getID(Params::ChannelMode)), "Channels"),
+    rateSliderAttachment(audioProcessor.apvts, Params::getID(Params::Rate), rateSlider),
+    rateTypeSliderAttachment(audioProcessor.apvts, Params::getID(Params::RateType), rateTypeSlider),
+    orderSliderAttachment(audioProcessor.apvts, Params::getID(Params::Order), orderSlider),
+    velFineCtrlSliderAttachment(audioProcessor.apvts, Params::getID(Params::VelFineCtrl), velFineCtrlSlider),
+    noteLenSliderAttachment(audioProcessor.apvts, Params::getID(Params::NoteLength), noteLenSlider),
+    noteOverlapSliderAttachment(audioProcessor.apvts, Params::getID(Params::NoteOverlap), noteOverlapSlider),
+    repeatsSliderAttachment(audioProcessor.apvts, Params::getID(Params::Repeats), repeatsSlider),
+    deltaSliderAttachment(audioProcessor.apvts, Params::getID(Params::Delta), deltaSlider),
+    offsetsSliderAttachment(audioProcessor.apvts, Params::getID(Params::Offsets), offsetsSlider),
+    seedSliderAttachment(audioProcessor.apvts, Params::getID(Params::Seed), seedSlider),
+    channelModeSliderAttachment(audioProcessor.apvts, Params::getID(Params::ChannelMode), channelModeSlider)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -151,8 +261,65 @@ HARPyAudioProcessorEditor::HARPyAudioProcessorEditor (HARPyAudioProcessor& p)
     for (auto* comp : getComps()) {
         addAndMakeVisible(comp);
     }
+    addAndMakeVisible(stepView);
+    addAndMakeVisible(modulationView);
+
+    using Format = RotarySliderWithLabel::Format;
+    auto& apvts = audioProcessor.apvts;
+    auto addSection = [this](const juce::String& name, ParameterPanel* panel) {
+        sections.addTab(name, juce::Colours::darkgrey, panel, true);
+    };
+
+    addSection("Routing", new ParameterPanel(apvts, {
+        { Params::PassNotes, "Pass Notes" },
+        { Params::PassControllers, "Pass CCs" },
+        { Params::PassPitchBend, "Pass Bend" },
+        { Params::PassAftertouch, "Pass AT" },
+        { Params::PassProgramChange, "Pass PC" },
+        { Params::PassOther, "Pass Other" },
+    }));
+
+    for (int zone = 0; zone < KeyZones::maxZones; ++zone) {
+        auto param = [zone](Params::Index zone1Param) { return Params::getZoneParam(zone, zone1Param); };
+        addSection("Zone " + juce::String(zone + 1), new ParameterPanel(apvts, {
+            { param(Params::Zone1Mode), "Mode" },
+            { param(Params::Zone1LowKey), "Low Key", Format::NoteName },
+            { param(Params::Zone1HighKey), "High Key", Format::NoteName },
+            { param(Params::Zone1LowVelocity), "Low Vel" },
+            { param(Params::Zone1HighVelocity), "High Vel" },
+        }));
+    }
 
-    setSize (600, 125);
+    addSection("Sidechain", new ParameterPanel(apvts, {
+        { Params::SidechainDetector, "Detector" },
+        { Params::SidechainRelease, "Release", Format::Value, "ms" },
+        { Params::SidechainThreshold, "Threshold", Format::Value, "dB" },
+        { Params::SidechainVelocity, "Velocity" },
+        { Params::SidechainGate, "Gate" },
+        { Params::StepsOnOnsets, "Steps on Onsets" },
+    }));
+
+    addSection("Transform", new ParameterPanel(apvts, {
+        { Params::Transpose, "Transpose" },
+        { Params::Scale, "Scale" },
+        { Params::Key, "Key" },
+        { Params::LowNote, "Low Note", Format::NoteName },
+        { Params::HighNote, "High Note", Format::NoteName },
+        { Params::RangeMode, "Range" },
+        { Params::VelocityCurve, "Vel Curve" },
+    }));
+
+    addSection("Voices", new ParameterPanel(apvts, {
+        { Params::MaxVoices, "Max Voices" },
+        { Params::VoiceStealing, "Stealing" },
+    }));
+
+    sections.setTabBarDepth(24);
+    sections.setOutline(0);
+    addAndMakeVisible(sections);
+
+    setOpaque(true);
+    setSize (845, 100 + 80 + knobRowHeight + sectionsHeight + titleHeight);
 }
 
 HARPyAudioProcessorEditor::~HARPyAudioProcessorEditor()
@@ -168,18 +335,12 @@ void HARPyAudioProcessorEditor::paint (juce::Graphics& g)
 
     g.fillAll(Colours::black);
 
-    auto bounds = getLocalBounds();
-    auto titleArea = bounds.removeFromBottom(bounds.getHeight() * 0.1f);
+    auto titleArea = getLocalBounds().removeFromBottom(titleHeight);
     auto h = titleArea.getHeight();
 
     g.setColour(Colours::white);
     g.setFont(h);
     g.drawFittedText("hARPy v0.0.2 by tri99er", titleArea, Justification::centredLeft, 1);
-
-    /*g.setColour (juce::Colours::white);
-    g.setFont (juce::FontOptions (15.0f));
-    juce::String bpm = juce::String(audioProcessor.hostBPM);
-    g.drawFittedText (bpm, getLocalBounds(), juce::Justification::centred, 1);*/
 }
 
 void HARPyAudioProcessorEditor::resized()
@@ -189,40 +350,36 @@ void HARPyAudioProcessorEditor::resized()
 
     auto bounds = getLocalBounds();
 
-    auto titleArea = bounds.removeFromBottom(bounds.getHeight() * 0.1f);
-
-    auto rateArea = bounds.removeFromLeft(bounds.getWidth() / 7.f);
-    bounds.removeFromLeft(1);
-    auto orderArea = bounds.removeFromLeft(bounds.getWidth() / 6.f);
-    bounds.removeFromLeft(1);
-    auto velFineCtrlArea = bounds.removeFromLeft(bounds.getWidth() / 5.f);
-    bounds.removeFromLeft(1);
-    auto noteLenArea = bounds.removeFromLeft(bounds.getWidth() / 4.f);
-    bounds.removeFromLeft(1);
-    auto repeatsArea = bounds.removeFromLeft(bounds.getWidth() / 3.f);
-    bounds.removeFromLeft(1);
-    auto deltaArea = bounds.removeFromLeft(bounds.getWidth() / 2.f);
-    bounds.removeFromLeft(1);
-    auto offsetsArea = bounds;
-
-    rateSlider.setBounds(rateArea);
-    orderSlider.setBounds(orderArea);
-    velFineCtrlSlider.setBounds(velFineCtrlArea);
-    noteLenSlider.setBounds(noteLenArea);
-    repeatsSlider.setBounds(repeatsArea);
-    deltaSlider.setBounds(deltaArea);
-    offsetsSlider.setBounds(offsetsArea);
+    stepView.setBounds(bounds.removeFromTop(100));
+    modulationView.setBounds(bounds.removeFromTop(80));
+
+    bounds.removeFromBottom(titleHeight);
+    sections.setBounds(bounds.removeFromBottom(sectionsHeight));
+
+    // Split the rest evenly between the knobs, one pixel apart.
+    auto comps = getComps();
+    for (size_t i = 0; i < comps.size(); ++i) {
+        auto area = (i + 1 < comps.size())
+            ? bounds.removeFromLeft(bounds.getWidth() / float(comps.size() - i))
+            : bounds;
+        bounds.removeFromLeft(1);
+        comps[i]->setBounds(area);
+    }
 }
 
 std::vector<juce::Component*> HARPyAudioProcessorEditor::getComps()
 {
     return {
         &rateSlider,
+        &rateTypeSlider,
         &orderSlider,
         &velFineCtrlSlider,
         &noteLenSlider,
+        &noteOverlapSlider,
         &repeatsSlider,
         &deltaSlider,
         &offsetsSlider,
+        &seedSlider,
+        &channelModeSlider,
     };
 }
@@ -9,8 +9,17 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ModulationView.h"
 #include "PluginProcessor.h"
+#include "StepView.h"
 
+/**
+    Shared by every knob of every open editor, through SharedResourcePointer.
+
+    The knob body doesn't depend on the value, so it is rendered once per
+    size and display scale into an image; a paint then only blits the image,
+    rotates the pointer and draws the label.
+*/
 struct LookAndFeel : juce::LookAndFeel_V4 {
     void drawRotarySlider(juce::Graphics&,
         int x, int y, int width, int height,
@@ -18,30 +27,85 @@ struct LookAndFeel : juce::LookAndFeel_V4 {
         float rotaryStartAngle,
         float rotaryEndAngle,
         juce::Slider&) override;
+
+private:
+    struct CachedKnob {
+        int width, height;
+        float scale;
+        juce::Image image;
+    };
+
+    const juce::Image& getKnobImage(int width, int height, float scale);
+
+    std::vector<CachedKnob> knobCache;
 };
 
-struct RotarySliderWithLabel : juce::Slider {
-    RotarySliderWithLabel(juce::RangedAudioParameter& rap, const juce::String& t) :
-        juce::Slider(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag, juce::Slider::TextEntryBoxPosition::NoTextBox),
-        param(&rap),
-        title(t)
-    {
-        setLookAndFeel(&lnf);
-    }
+/**
+    A rotary knob with its title and current value printed below it.
 
-    ~RotarySliderWithLabel() {
+    The value's text is worked out in valueChanged() rather than on every
+    paint, and the knob is opaque, so a parameter change repaints this knob
+    and nothing else.
+*/
+struct RotarySliderWithLabel : juce::Slider {
+    enum class Format {
+        Automatic,  // by the parameter's type
+        Choice,
+        Percent,
+        Integer,
+        Repeats,
+        NoteName,
+        Value,      // with the unit after it
+    };
+
+    RotarySliderWithLabel(juce::RangedAudioParameter& rap, const juce::String& t,
+                          Format f = Format::Automatic, const juce::String& u = {});
+
+    ~RotarySliderWithLabel() override {
         setLookAndFeel(nullptr);
     }
 
     void paint(juce::Graphics& g) override;
+    void valueChanged() override;
     juce::Rectangle<int> getSliderBounds() const;
     int getTextHeight() const { return 14; }
-    juce::String getDisplayString() const;
+    const juce::String& getDisplayString() const { return displayString; }
+    float getDisplayStringWidth() const { return displayStringWidth; }
 private:
-    LookAndFeel lnf;
+    juce::SharedResourcePointer<LookAndFeel> lnf;
 
-    juce::RangedAudioParameter* param;
+    juce::AudioParameterChoice* choiceParam{ nullptr };
+    Format format{ Format::Integer };
     juce::String title;
+    juce::String unit;
+
+    juce::String displayString;
+    float displayStringWidth{ 0.f };
+};
+
+//==============================================================================
+/**
+    A row of controls for a handful of parameters: a knob for each, or a
+    switch for the on/off ones, attached to the processor's parameters.
+*/
+class ParameterPanel : public juce::Component {
+public:
+    struct Control {
+        Params::Index index;
+        const char* title;
+        RotarySliderWithLabel::Format format = RotarySliderWithLabel::Format::Automatic;
+        const char* unit = "";
+    };
+
+    ParameterPanel(juce::AudioProcessorValueTreeState& apvts, std::initializer_list<Control> controls);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    std::vector<std::unique_ptr<juce::Component>> controls;
+    std::vector<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>> sliderAttachments;
+    std::vector<std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment>> buttonAttachments;
 };
 
 //==============================================================================
@@ -62,24 +126,42 @@ private:
     // access the processor object that created it.
     HARPyAudioProcessor& audioProcessor;
 
+    static constexpr int knobRowHeight = 113;
+    static constexpr int sectionsHeight = 140;
+    static constexpr int titleHeight = 12;
+
+    StepView stepView;
+    ModulationView modulationView;
+
+    // Routing, zones, sidechain, note transform and voices, one tab each.
+    juce::TabbedComponent sections{ juce::TabbedButtonBar::TabsAtTop };
+
     RotarySliderWithLabel rateSlider,
+        rateTypeSlider,
         orderSlider,
         velFineCtrlSlider,
         noteLenSlider,
+        noteOverlapSlider,
         repeatsSlider,
         deltaSlider,
-        offsetsSlider;
+        offsetsSlider,
+        seedSlider,
+        channelModeSlider;
 
     using APVTS = juce::AudioProcessorValueTreeState;
     using Attachment = APVTS::SliderAttachment;
 
     Attachment rateSliderAttachment,
+        rateTypeSliderAttachment,
         orderSliderAttachment,
         velFineCtrlSliderAttachment,
         noteLenSliderAttachment,
+        noteOverlapSliderAttachment,
         repeatsSliderAttachment,
         deltaSliderAttachment,
-        offsetsSliderAttachment;
+        offsetsSliderAttachment,
+        seedSliderAttachment,
+        channelModeSliderAttachment;
 
     std::vector<juce::Component*> getComps();
 
@@ -9,11 +9,37 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace {
+    /** The Pass switch that decides whether a message goes to the output,
+        by its status byte. */
+    Params::Index getPassParameter(const juce::MidiMessageMetadata& metadata)
+    {
+        switch (metadata.numBytes > 0 ? metadata.data[0] & 0xf0 : 0) {
+        case 0x80:
+        case 0x90:
+            return Params::PassNotes;
+        case 0xa0:
+        case 0xd0:
+            return Params::PassAftertouch;
+        case 0xb0:
+            return Params::PassControllers;
+        case 0xc0:
+            return Params::PassProgramChange;
+        case 0xe0:
+            return Params::PassPitchBend;
+        default:
+            return Params::PassOther;
+        }
+    }
+}
+
 //==============================================================================
 HARPyAudioProcessor::HARPyAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
+                     #if JucePlugin_IsMidiEffect
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
+                     #else
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
@@ -22,14 +48,23 @@ HARPyAudioProcessor::HARPyAudioProcessor()
                        )
 #endif
 {
-    apvts.addParameterListener("Delta", this);
-    apvts.addParameterListener("Offsets", this);
+    for (const auto& spec : Params::specs) {
+        parameterValues[spec.index] = apvts.getRawParameterValue(spec.id);
+        engineValues[spec.index] = spec.def;
+        readValues[spec.index] = spec.def;
+        apvts.addParameterListener(spec.id, this);
+    }
+
+    setModulationPattern(ArpModulationPattern::getDefault());
 }
 
 HARPyAudioProcessor::~HARPyAudioProcessor()
 {
-    apvts.removeParameterListener("Delta", this);
-    apvts.removeParameterListener("Offsets", this);
+    cancelPendingUpdate();
+
+    for (const auto& spec : Params::specs) {
+        apvts.removeParameterListener(spec.id, this);
+    }
 }
 
 //==============================================================================
@@ -72,38 +107,71 @@ double HARPyAudioProcessor::getTailLengthSeconds() const
 
 int HARPyAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return ArpProgramBank::numPrograms;
 }
 
 int HARPyAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
 void HARPyAudioProcessor::setCurrentProgram (int index)
 {
+    if (juce::isPositiveAndBelow(index, ArpProgramBank::numPrograms)) {
+        const juce::ScopedLock lock(programLock);
+        currentProgram.store(index);
+        loadProgram(bank[index]);
+    }
 }
 
 const juce::String HARPyAudioProcessor::getProgramName (int index)
 {
+    if (juce::isPositiveAndBelow(index, ArpProgramBank::numPrograms)) {
+        const juce::ScopedLock lock(programLock);
+        return bank[index].getName();
+    }
     return {};
 }
 
 void HARPyAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    // The audio thread never looks at names, so its copy can stay as it is.
+    if (juce::isPositiveAndBelow(index, ArpProgramBank::numPrograms)) {
+        const juce::ScopedLock lock(programLock);
+        bank[index].setName(newName);
+    }
 }
 
 //==============================================================================
 void HARPyAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    noteVels.clear();
-    currentNote = 0;
-    lastNoteValue = std::make_pair(-1, juce::uint8(0));
-    time = 0;
-    rate = static_cast<float> (sampleRate);
-    absArpPos = 0;
-    repeat = 0;
+    // Room for far more events than a block can realistically carry, so the
+    // engine never has to drop any; the buffers don't grow once playing.
+    engineInput.reserve(maxInputEvents);
+    engineOutput.reserve(maxOutputEvents);
+
+    // Hosts may prepare again in the middle of playback, e.g. for a new
+    // sample rate. Notes still sounding are ended at the start of the next
+    // block rather than forgotten, and a Panic posted by reset() stays
+    // queued for it.
+    if (engine.hasOpenGates()) {
+        engine.panic(engineOutput);
+    }
+
+    engine.prepare(sampleRate);
+    metrics.prepare(sampleRate, samplesPerBlock);
+    sidechain.prepare(sampleRate, samplesPerBlock);
+    updateSidechain();
+
+    midiOutput.ensureSize(midiOutputBytes);
+    settingsChanges.reserve(maxParameterChanges);
+    numParameterChanges = 0;
+    numDroppedChanges = 0;
+}
+
+void HARPyAudioProcessor::reset()
+{
+    commands.post(ArpCommand::Panic);
 }
 
 void HARPyAudioProcessor::releaseResources()
@@ -116,8 +184,11 @@ void HARPyAudioProcessor::releaseResources()
 bool HARPyAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
   #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
+    // The only bus is the optional sidechain.
+    auto sidechainLayout = layouts.getMainInputChannelSet();
+    return sidechainLayout.isDisabled()
+        || sidechainLayout == juce::AudioChannelSet::mono()
+        || sidechainLayout == juce::AudioChannelSet::stereo();
   #else
     // This is the place where you check if the layout is supported.
     // In this template code we only support mono or stereo.
@@ -140,214 +211,458 @@ bool HARPyAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
 
 void HARPyAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    // Update host BPM
-    auto tmpBPM = getPlayHead()->getPosition()->getBpm();
+    metrics.beginBlock();
+
+    // A program chosen by the host or restored with the session arrives
+    // whole and already decoded, once the parameters hold it.
+    if (programStates.acquire()) {
+        const auto& state = programStates.getFront();
+        if (state.serial != appliedProgramSerial) {
+            appliedProgramSerial = state.serial;
+            readValues = state.program.values;
+            applyProgram(state.program);
+        }
+    }
 
-    // NOTE: When you're running standalone, you won't get a value here, as there is no host environment
-    if (tmpBPM.hasValue()) {
-        // Set your module level variable to the retrieved value, for use elsewhere
-        hostBPM = (int)*tmpBPM;
+    // Parameters are only re-read, and everything derived from them only
+    // recomputed, after one of them has changed, and then only the ones that
+    // moved are taken: after a MIDI Program Change the others still hold the
+    // previous program until the message thread catches up. One with change
+    // points in this block keeps its old value until the first of them, even
+    // though the host has already set it to where the block ends.
+    auto version = parameterVersion.load();
+    if (version != settingsVersion) {
+        settingsVersion = version;
+
+        ArpeggiatorSettings settings;
+        for (const auto& spec : Params::specs) {
+            auto value = parameterValues[spec.index]->load();
+            if (value != readValues[spec.index]) {
+                readValues[spec.index] = value;
+                if (!isAutomated(spec.index)) {
+                    engineValues[spec.index] = value;
+                }
+            }
+            applyParameter(settings, spec.index, engineValues[spec.index]);
+        }
+        engine.setSettings(settings);
+        updateKeyZones();
+        updateSidechain();
     }
-    else {
-        hostBPM = 120; // Default value
+
+    // Likewise the modulation lanes are only compiled after an edit.
+    auto modulationEdit = modulationVersion.load();
+    if (modulationEdit != builtModulationVersion) {
+        builtModulationVersion = modulationEdit;
+        engine.setModulation(ArpModulation(getModulationPattern()));
     }
 
-    auto settings = getArpeggiatorSettings(apvts);
+    // A MIDI effect's buffer only has channels when the sidechain is
+    // connected; it still gives the block's length.
+    auto numSamples = buffer.getNumSamples();
+    sidechain.process(buffer.getArrayOfReadPointers(), juce::jmin(getTotalNumInputChannels(), buffer.getNumChannels()), numSamples);
+    auto sidechainBlock = sidechain.getBlock();
 
-    auto rateCoefficient = std::powf(2.0f, settings.rate);
+    // The output may already hold the note-offs of a prepareToPlay().
+    engineInput.clear();
 
-    // the audio buffer in a midi effect will have zero channels!
-    jassert(buffer.getNumChannels() == 0);
-    // however we use the buffer to get timing information
-    auto numSamples = buffer.getNumSamples();
-    // get noteVel duration
-    const auto secondsInMinute = 60.0f;
+    commands.drain([this](ArpCommand command) {
+        switch (command) {
+        case ArpCommand::Panic:
+            engine.panic(engineOutput);
+            break;
+        }
+    });
+
+    for (const auto metadata : midiMessages) {
+        auto msg = metadata.getMessage();
+
+        if (msg.isNoteOn() || msg.isNoteOff()) {
+            // A note-off goes wherever its note-on went, even if the zones
+            // have changed in between.
+            auto channelBit = std::uint16_t(1 << (msg.getChannel() - 1));
+            auto& zonedChannels = zonedThroughNotes[size_t(msg.getNoteNumber())];
+            auto isArpeggiated = msg.isNoteOn()
+                ? keyZones.getRoute(msg.getNoteNumber(), msg.getVelocity()) == NoteRoute::Arpeggiate
+                : (zonedChannels & channelBit) == 0;
+
+            zonedChannels = isArpeggiated ? std::uint16_t(zonedChannels & ~channelBit) : std::uint16_t(zonedChannels | channelBit);
+
+            if (isArpeggiated) {
+                engineInput.add({ metadata.samplePosition, msg.isNoteOn() ? ArpEvent::NoteOn : ArpEvent::NoteOff,
+                                  std::uint8_t(msg.getChannel()), std::uint8_t(msg.getNoteNumber()),
+                                  msg.isNoteOn() ? msg.getVelocity() : std::uint8_t(0) });
+            }
+        }
+        else if (msg.isProgramChange()) {
+            handleProgramChange(metadata.samplePosition, msg.getProgramChangeNumber());
+        }
+        else if (!passesThrough(metadata)) {
+            // Switched off, not lost: counted apart from real drops.
+            metrics.countFiltered();
+        }
+    }
+
+    settingsChanges.clear();
+    if (numParameterChanges > 0) {
+        collectSettingsChanges();
+        updateKeyZones();
+        updateSidechain();
+    }
+
+    auto transport = getTransport();
+    auto stats = engine.process(transport, numSamples, engineInput, engineOutput, &settingsChanges, &sidechainBlock);
+    pushDisplayEvents(transport.isPlaying);
 
-    // Seriously can't figure what this is, but it works
-    const auto magicFactor = 4.0f;
+    writeMidiOutput(midiMessages);
 
-    auto ts = getPlayHead()->getPosition()->getTimeSignature();
+    metrics.countDropped(engineInput.getNumDropped() + engineOutput.getNumDropped() + numDroppedChanges);
+    metrics.countStray(stats.strayNoteOffs);
+    numDroppedChanges = 0;
+    metrics.countLate(stats.late);
+    metrics.countClamped(stats.clamped);
+    metrics.endBlock(numSamples, engine.getNumHeldNotes(), engineOutput.size());
+    engineOutput.clear();
+}
 
-    auto beatsInBar = 4.0f;
-    auto beatLength = 4.0f;
-    if (ts.hasValue()) {
-        beatsInBar = float(ts->numerator);
-        beatLength = float(ts->denominator);
+bool HARPyAudioProcessor::passesThrough(const juce::MidiMessageMetadata& metadata) const
+{
+    return engineValues[getPassParameter(metadata)] >= 0.5f;
+}
+
+bool HARPyAudioProcessor::passNote(const juce::MidiMessageMetadata& metadata)
+{
+    if (metadata.numBytes < 3) {
+        return false;
     }
 
-    auto noteDuration = static_cast<int> (rate * secondsInMinute * magicFactor * beatsInBar
-        / beatLength / float(hostBPM) / rateCoefficient);
+    auto channelBit = std::uint16_t(1 << (metadata.data[0] & 0x0f));
+    auto& passedChannels = passedNotes[size_t(metadata.data[1] & 0x7f)];
+    auto isNoteOn = (metadata.data[0] & 0xf0) == 0x90 && metadata.data[2] > 0;
 
-    for (const auto metadata : midiMessages)
-    {
-        const auto msg = metadata.getMessage();
-        if (msg.isNoteOn()) {
-            noteVels.add(std::make_pair(msg.getNoteNumber(), msg.getVelocity()));
-            for (int i = 0; i < settings.offsets; ++i) {
-                noteVels.add(std::make_pair(msg.getNoteNumber() + settings.delta * (i + 1), msg.getVelocity()));
-            }
+    // Only note-offs of notes that went out follow them, so switching Pass
+    // Notes or the zones while keys are down leaves nothing hanging.
+    if (!isNoteOn) {
+        auto passes = (passedChannels & channelBit) != 0;
+        passedChannels &= std::uint16_t(~channelBit);
+        return passes;
+    }
+
+    auto passes = passesThrough(metadata)
+               || keyZones.getRoute(metadata.data[1], metadata.data[2]) == NoteRoute::PassThrough;
+    passedChannels = passes ? std::uint16_t(passedChannels | channelBit) : std::uint16_t(passedChannels & ~channelBit);
+    return passes;
+}
+
+void HARPyAudioProcessor::updateKeyZones()
+{
+    std::array<KeyZones::Zone, KeyZones::maxZones> zones;
+
+    for (int i = 0; i < KeyZones::maxZones; ++i) {
+        auto value = [this, i](Params::Index zone1Param) { return int(engineValues[Params::getZoneParam(i, zone1Param)]); };
+        auto mode = value(Params::Zone1Mode);
+
+        auto& zone = zones[size_t(i)];
+        zone.isEnabled = mode != 0;
+        zone.route = mode == 2 ? NoteRoute::PassThrough : NoteRoute::Arpeggiate;
+        zone.lowKey = value(Params::Zone1LowKey);
+        zone.highKey = value(Params::Zone1HighKey);
+        zone.lowVelocity = value(Params::Zone1LowVelocity);
+        zone.highVelocity = value(Params::Zone1HighVelocity);
+    }
+
+    keyZones.setZones(zones);
+}
+
+void HARPyAudioProcessor::updateSidechain()
+{
+    sidechain.setParameters(ArpSidechain::Detector(int(engineValues[Params::SidechainDetector])),
+                            engineValues[Params::SidechainRelease],
+                            engineValues[Params::SidechainThreshold]);
+}
+
+void HARPyAudioProcessor::writeMidiOutput(juce::MidiBuffer& midiMessages)
+{
+    // The input that passes through and the engine's output, both in time
+    // order, are merged in one pass, input first on a shared sample. Each
+    // event is appended, so nothing is ever moved to insert one, and the
+    // storage reserved in prepareToPlay means nothing is allocated either.
+    midiOutput.clear();
+
+    auto addEngineEvent = [this](const ArpEvent& event) {
+        switch (event.type) {
+        case ArpEvent::NoteOn:
+            midiOutput.addEvent(juce::MidiMessage::noteOn(event.channel, event.note, event.velocity), event.offset);
+            break;
+        case ArpEvent::NoteOff:
+            midiOutput.addEvent(juce::MidiMessage::noteOff(event.channel, event.note), event.offset);
+            break;
+        case ArpEvent::AllNotesOff:
+            midiOutput.addEvent(juce::MidiMessage::allNotesOff(event.channel), event.offset);
+            break;
         }
-        else if (msg.isNoteOff()) {
-            for (juce::uint8 i = 0; i <= 127; ++i) {
-                noteVels.removeValue(std::make_pair(msg.getNoteNumber(), i));
-            }
-            for (int i = 0; i < settings.offsets; ++i) {
-                for (juce::uint8 j = 0; j <= 127; ++j) {
-                    noteVels.removeValue(std::make_pair(msg.getNoteNumber() + settings.delta * (i + 1), j));
-                }
-            }
+    };
+
+    const auto* event = engineOutput.begin();
+
+    for (const auto metadata : midiMessages) {
+        auto passes = getPassParameter(metadata) == Params::PassNotes ? passNote(metadata) : passesThrough(metadata);
+        if (!passes) {
+            continue;
+        }
+
+        for (; event != engineOutput.end() && event->offset < metadata.samplePosition; ++event) {
+            addEngineEvent(*event);
         }
+        midiOutput.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
     }
+
+    for (; event != engineOutput.end(); ++event) {
+        addEngineEvent(*event);
+    }
+
+    // The merged events are copied back, so the storage reserved here stays
+    // here. Hosts pass the same buffer every block, so the room made in it
+    // the first time lasts, and it never has to grow while playing.
     midiMessages.clear();
+    midiMessages.ensureSize(midiOutputBytes);
+    midiMessages.addEvents(midiOutput, 0, -1, 0);
+}
+
+ArpTransport HARPyAudioProcessor::getTransport() const
+{
+    ArpTransport transport;
 
-    if (noteVels.size() == 0) {
-        absArpPos = 0;
-        repeat = 0;
+    // NOTE: When you're running standalone, you won't get these values, as there is no host environment
+    auto* playHead = getPlayHead();
+    auto position = (playHead != nullptr) ? playHead->getPosition() : juce::Optional<juce::AudioPlayHead::PositionInfo>();
+
+    if (position.hasValue()) {
+        if (auto bpm = position->getBpm(); bpm.hasValue()) {
+            transport.bpm = *bpm;
+        }
+        if (auto ts = position->getTimeSignature(); ts.hasValue()) {
+            transport.timeSigNumerator = ts->numerator;
+            transport.timeSigDenominator = ts->denominator;
+        }
+        if (auto ppq = position->getPpqPosition(); ppq.hasValue()) {
+            transport.isPlaying = position->getIsPlaying();
+            transport.ppqPosition = *ppq;
+
+            if (auto barStart = position->getPpqPositionOfLastBarStart(); barStart.hasValue() && transport.isPlaying) {
+                transport.hasBarStart = true;
+                transport.ppqPositionOfLastBarStart = *barStart;
+            }
+        }
     }
 
-    if ((settings.repeats > 0) && (repeat >= settings.repeats)) {
+    return transport;
+}
+
+void HARPyAudioProcessor::addParameterChange(int sampleOffset, Params::Index index, float value)
+{
+    addChange({ sampleOffset, index, value });
+}
+
+void HARPyAudioProcessor::addChange(const ParameterChange& change)
+{
+    // Changes mostly arrive before processBlock starts the metrics' block,
+    // so they are counted there.
+    if (numParameterChanges == maxParameterChanges) {
+        ++numDroppedChanges;
         return;
     }
 
-    if ((time + numSamples) >= int(noteDuration * settings.noteLength)
-        && (lastNoteValue.first > 0 || settings.order == ChordRepeat)) {
-        auto offset = juce::jmax(0, juce::jmin(int(int(noteDuration * settings.noteLength) - time), numSamples - 1));
-        switch (settings.order) {
-        default:
-        case Up:
-        case Down:
-        case UpDown:
-        case DownUp:
-        case UpAndDown:
-        case DownAndUp:
-        case Random:
-            midiMessages.addEvent(juce::MidiMessage::noteOff(1, lastNoteValue.first), offset);
-            lastNoteValue = std::make_pair(-1, juce::uint8(0));
-            break;
-        case ChordRepeat:
-            for (auto& noteVel : noteVels) {
-                midiMessages.addEvent(juce::MidiMessage::noteOff(1, noteVel.first), offset);
-            }
-            break;
+    // Kept sorted by offset as they come in, later ones last on the same
+    // sample; there are only ever a handful per block.
+    auto i = numParameterChanges++;
+    for (; i > 0 && parameterChanges[size_t(i - 1)].offset > change.offset; --i) {
+        parameterChanges[size_t(i)] = parameterChanges[size_t(i - 1)];
+    }
+    parameterChanges[size_t(i)] = change;
+}
+
+bool HARPyAudioProcessor::isAutomated(Params::Index index) const
+{
+    for (int i = 0; i < numParameterChanges; ++i) {
+        const auto& change = parameterChanges[size_t(i)];
+        if (change.index == index || change.program != nullptr) {
+            return true;
         }
     }
-    if ((time + numSamples) >= noteDuration && noteVels.size() > 0) {
-        auto offset = juce::jmax(0, juce::jmin(int(noteDuration - time), numSamples - 1));
+    return false;
+}
 
-        auto absArpLen = getAbsoluteArpeggioLength();
-        juce::uint8 finalVel = 0;
+void HARPyAudioProcessor::collectSettingsChanges()
+{
+    auto settings = engine.getSettings();
 
-        switch (settings.order) {
-        default:
-        case Up:
-        case Down:
-        case UpDown:
-        case DownUp:
-        case UpAndDown:
-        case DownAndUp:
-        case Random:
-            switch (settings.order)
-            {
-            default:
-            case Up:
-                currentNote = absArpPos;
-                break;
-            case Down:
-                currentNote = absArpLen - 1 - absArpPos;
-                break;
-            case UpDown:
-                if (noteVels.size() <= 1) {
-                    currentNote = 0;
-                    break;
-                }
+    for (int i = 0; i < numParameterChanges; ++i) {
+        const auto& change = parameterChanges[size_t(i)];
 
-                if (absArpPos < noteVels.size()) {
-                    currentNote = absArpPos;
-                }
-                else {
-                    currentNote = absArpLen - absArpPos;
-                }
-                break;
-            case DownUp:
-                if (noteVels.size() <= 1) {
-                    currentNote = 0;
-                    break;
-                }
+        if (change.program != nullptr) {
+            engineValues = change.program->values;
+            settings = change.program->settings;
+        }
+        else {
+            engineValues[change.index] = change.value;
+            applyParameter(settings, change.index, change.value);
+        }
 
-                if (absArpPos < noteVels.size()) {
-                    currentNote = noteVels.size() - 1 - absArpPos;
-                }
-                else {
-                    currentNote = absArpPos - noteVels.size() + 1;
-                }
-                break;
-            case UpAndDown:
-                if (noteVels.size() <= 1) {
-                    currentNote = 0;
-                    break;
-                }
+        // Parameters moving on the same sample make a single change.
+        if (i + 1 < numParameterChanges && parameterChanges[size_t(i + 1)].offset == change.offset) {
+            continue;
+        }
 
-                if (absArpPos < noteVels.size()) {
-                    currentNote = absArpPos;
-                }
-                else {
-                    currentNote = absArpLen - 1 - absArpPos;
-                }
-                break;
-            case DownAndUp:
-                if (noteVels.size() <= 1) {
-                    currentNote = 0;
-                    break;
-                }
+        settingsChanges.add({ change.offset, settings });
+    }
 
-                if (absArpPos < noteVels.size()) {
-                    currentNote = noteVels.size() - 1 - absArpPos;
-                }
-                else {
-                    currentNote = absArpPos - noteVels.size();
-                }
-                break;
-            case Random:
-                juce::Random rng;
-                auto tmp = rng.nextInt(noteVels.size());
-                if (currentNote != tmp) {
-                    currentNote = tmp;
-                }
-                else {
-                    currentNote = (currentNote == noteVels.size() - 1)
-                        ? currentNote - 1
-                        : currentNote + 1;
-                }
-                break;
-            }
+    numParameterChanges = 0;
+}
 
-            lastNoteValue = noteVels[currentNote];
+void HARPyAudioProcessor::applyProgram(const ArpProgram& program)
+{
+    engineValues = program.values;
+    engine.setSettings(program.settings);
+    updateKeyZones();
+    updateSidechain();
+}
 
-            finalVel = juce::uint8(float(lastNoteValue.second) * settings.velFineCtrl);
-            midiMessages.addEvent(juce::MidiMessage::noteOn(1, lastNoteValue.first, finalVel), offset);
+void HARPyAudioProcessor::handleProgramChange(int sampleOffset, int index)
+{
+    if (index >= ArpProgramBank::numPrograms) {
+        metrics.countDropped();
+        return;
+    }
 
-            ++absArpPos;
-            if (absArpPos >= absArpLen) {
-                absArpPos = 0;
-            }
+    // Takes effect at its sample like any other change, as one snapshot; the
+    // parameters follow on the message thread.
+    const auto& program = programStates.getFront().bank[index];
+    addChange({ sampleOffset, Params::numParams, 0.f, &program });
 
-            if (settings.repeats > 0 && absArpPos == 0) {
-                ++repeat;
-            }
-            break;
-        case ChordRepeat:
-            for (auto& noteVel : noteVels) {
-                juce::uint8 finalVel = juce::uint8(float(noteVel.second) * settings.velFineCtrl);
-                midiMessages.addEvent(juce::MidiMessage::noteOn(1, noteVel.first, finalVel), offset);
-            }
-            if (settings.repeats > 0) {
-                ++repeat;
-            }
-            break;
+    currentProgram.store(index);
+    programToSync.store(index);
+    triggerAsyncUpdate();
+}
+
+void HARPyAudioProcessor::loadProgram(const ArpProgram& program)
+{
+    // Callers that read the program from the bank hold the lock already;
+    // taking it again here makes sure nothing publishes without it.
+    const juce::ScopedLock lock(programLock);
+    setParameters(program.values);
+
+    // Published only once the parameters hold it, so nothing the audio
+    // thread reads afterwards disagrees with it. The copy written is one the
+    // audio thread has given back, so it can't be reading it.
+    auto& state = programStates.getBack();
+    state.bank = bank;
+    state.program = program;
+    state.serial = ++numProgramsLoaded;
+    programStates.publish();
+}
+
+void HARPyAudioProcessor::setParameters(const ParameterSnapshot& values)
+{
+    // For the host and the editor; the engine gets the values as one
+    // snapshot, so these updates don't make the audio thread re-read them.
+    loadingThread.store(juce::Thread::getCurrentThreadId());
+
+    for (const auto& spec : Params::specs) {
+        auto* param = apvts.getParameter(spec.id);
+        param->setValueNotifyingHost(param->convertTo0to1(values[spec.index]));
+    }
+
+    loadingThread.store(nullptr);
+}
+
+void HARPyAudioProcessor::handleAsyncUpdate()
+{
+    // A MIDI Program Change has already reached the engine; this only shows
+    // it to the host and the editor. If another one comes in meanwhile, it
+    // triggers another update.
+    auto index = programToSync.exchange(-1);
+    if (index < 0) {
+        return;
+    }
+
+    const juce::ScopedLock lock(programLock);
+    setParameters(bank[index].values);
+    updateHostDisplay(ChangeDetails().withProgramChanged(true));
+}
+
+ArpModulationPattern HARPyAudioProcessor::getModulationPattern() const
+{
+    ArpModulationPattern pattern;
+
+    for (int target = 0; target < ArpModulationPattern::numTargets; ++target) {
+        pattern.lengths[size_t(target)] = modulationLengths[size_t(target)].load();
+        for (int step = 0; step < ArpModulationPattern::maxLength; ++step) {
+            pattern.values[size_t(target)][size_t(step)] = modulationValues[size_t(target * ArpModulationPattern::maxLength + step)].load();
+        }
+    }
+
+    return pattern;
+}
+
+void HARPyAudioProcessor::setModulationPattern(const ArpModulationPattern& pattern)
+{
+    for (int target = 0; target < ArpModulationPattern::numTargets; ++target) {
+        modulationLengths[size_t(target)] = ArpModulationPattern::clampLength(pattern.lengths[size_t(target)]);
+        for (int step = 0; step < ArpModulationPattern::maxLength; ++step) {
+            modulationValues[size_t(target * ArpModulationPattern::maxLength + step)]
+                = ArpModulationPattern::clampValue(target, pattern.values[size_t(target)][size_t(step)]);
         }
-        
     }
-    time = (time + numSamples) % noteDuration;
+
+    ++modulationVersion;
+}
+
+void HARPyAudioProcessor::setModulationValue(ArpModulationPattern::Target target, int step, float value)
+{
+    if (juce::isPositiveAndBelow(step, ArpModulationPattern::maxLength)) {
+        modulationValues[size_t(target * ArpModulationPattern::maxLength + step)] = ArpModulationPattern::clampValue(target, value);
+        ++modulationVersion;
+    }
+}
+
+void HARPyAudioProcessor::setModulationLength(ArpModulationPattern::Target target, int length)
+{
+    modulationLengths[size_t(target)] = ArpModulationPattern::clampLength(length);
+    ++modulationVersion;
+}
+
+void HARPyAudioProcessor::pushDisplayEvents(bool isPlaying)
+{
+    const auto& clock = engine.getClock();
+    auto blockStart = clock.getBlockStartPpq();
+    auto quartersPerSample = clock.getQuartersPerSample();
+    const auto* events = engineOutput.begin();
+
+    display.push(1 + engineOutput.size(), [&](int i) {
+        ArpDisplayEvent displayEvent{};
+
+        if (i == 0) {
+            displayEvent.type = ArpDisplayEvent::Block;
+            displayEvent.isPlaying = isPlaying;
+            displayEvent.bpm = float(clock.getBpm());
+            displayEvent.ppq = blockStart;
+            displayEvent.stepLength = clock.getStepLengthInQuarters();
+            displayEvent.gridOrigin = clock.getGridOriginPpq();
+            displayEvent.lastStep = clock.getNextStepIndex() - 1;
+            return displayEvent;
+        }
+
+        const auto& event = events[i - 1];
+        displayEvent.type = event.type == ArpEvent::NoteOn ? ArpDisplayEvent::NoteOn
+                          : event.type == ArpEvent::NoteOff ? ArpDisplayEvent::NoteOff
+                          : ArpDisplayEvent::AllNotesOff;
+        displayEvent.channel = event.channel;
+        displayEvent.note = event.note;
+        displayEvent.velocity = event.velocity;
+        displayEvent.ppq = blockStart + event.offset * quartersPerSample;
+        return displayEvent;
+    });
 }
 
 //==============================================================================
@@ -364,23 +679,43 @@ juce::AudioProcessorEditor* HARPyAudioProcessor::createEditor()
 //==============================================================================
 void HARPyAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    ArpSessionState session;
+    for (const auto& spec : Params::specs) {
+        session.values[spec.index] = parameterValues[spec.index]->load();
+    }
+    session.program = currentProgram.load();
+    session.modulation = getModulationPattern();
 
     juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    const juce::ScopedLock lock(programLock);
+    bank.write(mos, session);
 }
 
 void HARPyAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    juce::MemoryInputStream stream(data, size_t(sizeInBytes), false);
+    ArpSessionState session;
+
+    // Hosts may call this on any thread, so the bank is only touched under
+    // the lock, and the program is loaded before anyone else can change it.
+    const juce::ScopedLock lock(programLock);
+
+    if (bank.read(stream, session)) {
+        ArpProgram restored;
+        restored.setValues(session.values);
+        currentProgram.store(session.program);
+        setModulationPattern(session.modulation);
+        loadProgram(restored);
+        commands.post(ArpCommand::Panic);
+        return;
+    }
 
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
+    // Sessions saved before there were programs hold the parameter tree.
+    auto tree = juce::ValueTree::readFromData(data, size_t(sizeInBytes));
 
     if (tree.isValid()) {
         apvts.replaceState(tree);
+        commands.post(ArpCommand::Panic);
     }
 }
 
@@ -388,66 +723,31 @@ juce::AudioProcessorValueTreeState::ParameterLayout HARPyAudioProcessor::createP
 {
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
-    juce::StringArray rateChoices {
-        "1/1",
-        "1/2",
-        "1/4",
-        "1/8",
-        "1/16",
-        "1/32",
-        "1/64",
-    };
-
-    layout.add(std::make_unique<juce::AudioParameterChoice>("Rate", "Rate", rateChoices, 3));
-
-    juce::StringArray orderChoices{
-        "Up",
-        "Down",
-        "Up/Down",
-        "Down/Up",
-        "Up & Down",
-        "Down & Up",
-        "Random",
-        "Chord Repeat"
-    };
-
-    layout.add(std::make_unique<juce::AudioParameterChoice>("Order", "Order", orderChoices, 0));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Velocity Fine Control", "Velocity Fine Control", 0.01f, 1.f, 1.f));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Note Length", "Note Length", 0.01f, 1.f, 0.5f));
-
-    layout.add(std::make_unique<juce::AudioParameterInt>("Repeats", "Repeats", 0, 16, 0));
-
-    layout.add(std::make_unique<juce::AudioParameterInt>("Delta", "Delta", -24, 24, 0));
-
-    layout.add(std::make_unique<juce::AudioParameterInt>("Offsets", "Offsets", 0, 8, 0));
+    for (const auto& spec : Params::specs) {
+        switch (spec.type) {
+        case Params::Type::Choice: {
+            juce::StringArray choices;
+            for (int i = 0; i <= int(spec.max); ++i) {
+                choices.add(spec.choices[i]);
+            }
+            layout.add(std::make_unique<juce::AudioParameterChoice>(spec.id, spec.id, choices, int(spec.def)));
+            break;
+        }
+        case Params::Type::Float:
+            layout.add(std::make_unique<juce::AudioParameterFloat>(spec.id, spec.id, spec.min, spec.max, spec.def));
+            break;
+        case Params::Type::Int:
+            layout.add(std::make_unique<juce::AudioParameterInt>(spec.id, spec.id, int(spec.min), int(spec.max), int(spec.def)));
+            break;
+        case Params::Type::Bool:
+            layout.add(std::make_unique<juce::AudioParameterBool>(spec.id, spec.id, spec.def >= 0.5f));
+            break;
+        }
+    }
 
     return layout;
 }
 
-int HARPyAudioProcessor::getAbsoluteArpeggioLength()
-{
-    auto settings = getArpeggiatorSettings(apvts);
-    switch (ArpeggioOrder(settings.order))
-    {
-    default:
-    case Up:
-    case Down:
-    case Random:
-        return noteVels.size();
-        break;
-    case UpDown:
-    case DownUp:
-        return (noteVels.size() * 2) - 2;
-    case UpAndDown:
-    case DownAndUp:
-        return (noteVels.size() * 2);
-    case ChordRepeat:
-        return 1;
-    }
-}
-
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -455,23 +755,15 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new HARPyAudioProcessor();
 }
 
-ArpeggiatorSettings getArpeggiatorSettings(juce::AudioProcessorValueTreeState& apvts)
-{
-    ArpeggiatorSettings settings;
-
-    settings.rate = apvts.getRawParameterValue("Rate")->load();
-    settings.order = ArpeggioOrder(int(apvts.getRawParameterValue("Order")->load()));
-    settings.velFineCtrl = apvts.getRawParameterValue("Velocity Fine Control")->load();
-    settings.noteLength = apvts.getRawParameterValue("Note Length")->load();
-    settings.repeats = apvts.getRawParameterValue("Repeats")->load();
-    settings.delta = apvts.getRawParameterValue("Delta")->load();
-    settings.offsets = apvts.getRawParameterValue("Offsets")->load();
-
-    return settings;
-}
-
 void HARPyAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue) {
-    if (parameterID == "Delta" || parameterID == "Offsets") {
-        noteVels.clear();
+    if (loadingThread.load() != juce::Thread::getCurrentThreadId()) {
+        ++parameterVersion;
+    }
+
+    // Runs on whichever thread changed the parameter, so the note set is
+    // left to the audio thread. Notes held in one channel mode mean nothing
+    // in the other.
+    if (parameterID == Params::getID(Params::ChannelMode)) {
+        commands.post(ArpCommand::Panic);
     }
 }
@@ -9,34 +9,29 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-enum ArpeggioOrder {
-    Up,
-    Down,
-    UpDown,
-    DownUp,
-    UpAndDown,
-    DownAndUp,
-    Random,
-    ChordRepeat,
-};
-
-struct ArpeggiatorSettings {
-    float rate{ 0.f };
-    ArpeggioOrder order{ Up };
-    float velFineCtrl{ 1.f };
-    float noteLength{ 1.f };
-    int repeats{ 0 };
-    int delta{ 0 };
-    int offsets{ 0 };
-};
-
-ArpeggiatorSettings getArpeggiatorSettings(juce::AudioProcessorValueTreeState& apvts);
+#include "ArpCommandQueue.h"
+#include "ArpDisplayFifo.h"
+#include "ArpEngine.h"
+#include "ArpMetrics.h"
+#include "ArpProgramBank.h"
+#include "ArpTripleBuffer.h"
+#include "KeyZones.h"
+#include "Parameters.h"
+
+static_assert(std::size(Params::orderChoices) == numArpeggioOrders);
+static_assert(std::size(Params::rateChoices) == ArpClock::numRates);
+static_assert(std::size(Params::rateTypeChoices) == ArpClock::numRateTypes);
+static_assert(std::size(Params::scaleChoices) == NoteTransform::numScales);
+static_assert(std::size(Params::voiceStealingChoices) == VoiceLimiter::Quietest + 1);
+static_assert(Params::Zone4HighVelocity + 1 - Params::Zone1Mode == KeyZones::maxZones * Params::numZoneParams);
+
+using ParameterValues = std::array<std::atomic<float>*, Params::numParams>;
 
 //==============================================================================
 /**
 */
-class HARPyAudioProcessor  : public juce::AudioProcessor, juce::AudioProcessorValueTreeState::Listener
+class HARPyAudioProcessor  : public juce::AudioProcessor, juce::AudioProcessorValueTreeState::Listener,
+                             juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -46,6 +41,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -79,19 +75,113 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
 
-    int hostBPM = 120;
+    /** What was played, for the editor's step view. */
+    ArpDisplayFifo display;
+
+    /** Sample-accurate automation, for hosts or wrappers that know where in
+        the coming block each change falls. Call it on the audio thread before
+        processBlock, with the parameter's plain value; changes take effect at
+        their sample instead of at the start of the block. The parameter
+        itself should still end up at its final value, as hosts set it anyway.
+        Changes beyond maxParameterChanges per block are ignored. */
+    void addParameterChange(int sampleOffset, Params::Index index, float value);
+
+    static constexpr int maxParameterChanges = 256;
+
+    /** Per-step modulation lanes, for the editor. Not for the audio thread;
+        the engine picks up edits at the start of the next block. */
+    ArpModulationPattern getModulationPattern() const;
+    void setModulationPattern(const ArpModulationPattern& pattern);
+    void setModulationValue(ArpModulationPattern::Target target, int step, float value);
+    void setModulationLength(ArpModulationPattern::Target target, int length);
+
+    /** Changes whenever the lanes are edited or restored. */
+    juce::uint32 getModulationVersion() const { return modulationVersion.load(); }
 
 private:
     //==============================================================================
-    int currentNote;
-    std::pair<int, juce::uint8> lastNoteValue;
-    int time;
-    float rate;
-    juce::SortedSet<std::pair<int, juce::uint8>> noteVels;
-    int absArpPos = 0;
-    int repeat = 0;
-
-    int getAbsoluteArpeggioLength();
+    ParameterValues parameterValues{};
+    std::array<float, Params::numParams> engineValues{};  // what the engine is running with
+    std::array<float, Params::numParams> readValues{};    // the parameters as last read by the audio thread
+    std::atomic<juce::uint32> parameterVersion{ 1 };
+    juce::uint32 settingsVersion = 0;
+
+    ArpCommandQueue commands;
+    ArpEngine engine;
+    ArpEventBuffer engineInput;
+    ArpEventBuffer engineOutput;
+    juce::MidiBuffer midiOutput;  // the merged output, copied to the host's buffer
+
+    static constexpr int maxInputEvents = 2048;
+    static constexpr int maxOutputEvents = 8192;
+
+    // A MidiBuffer event is a 6 byte header and the message, so this fits
+    // all of the engine's output and the input passed along with it.
+    static constexpr size_t midiOutputBytes = size_t(maxInputEvents + maxOutputEvents) * 16;
+    KeyZones keyZones;
+    ArpSidechain sidechain;
+
+    // Per note, the channels its held note-on was routed through by a zone,
+    // and the channels its note-on went to the output on.
+    std::array<std::uint16_t, 128> zonedThroughNotes{};
+    std::array<std::uint16_t, 128> passedNotes{};
+    ArpMetricsRecorder metrics;
+
+    struct ParameterChange {
+        int offset;
+        Params::Index index;
+        float value;
+        const ArpProgram* program = nullptr;  // a whole program, from a MIDI Program Change,
+                                              // in the audio thread's copy of the bank
+    };
+
+    std::array<ParameterChange, maxParameterChanges> parameterChanges{};
+    int numParameterChanges = 0;
+    int numDroppedChanges = 0;  // counted into the metrics at the end of the block
+    ArpSettingsChangeBuffer settingsChanges;
+
+    // The bank belongs to whoever holds programLock: the host may restore a
+    // state on another thread while the message thread switches programs.
+    // Each program loaded goes to the audio thread together with a copy of
+    // the bank, for MIDI Program Changes; the audio thread holds on to that
+    // copy until it takes the next one. The lock also keeps programStates
+    // down to one writer; the audio thread never takes it.
+    struct ProgramState {
+        ArpProgramBank bank;
+        ArpProgram program;
+        juce::uint32 serial = 0;  // which load this is
+    };
+
+    juce::CriticalSection programLock;
+    ArpProgramBank bank;
+    ArpTripleBuffer<ProgramState> programStates;
+    juce::uint32 numProgramsLoaded = 0;     // programLock
+    juce::uint32 appliedProgramSerial = 0;  // audio thread
+    std::atomic<int> currentProgram{ 0 };
+    std::atomic<int> programToSync{ -1 };  // switched to by MIDI, parameters not yet updated
+    std::atomic<juce::Thread::ThreadID> loadingThread{ nullptr };
+
+    // The modulation lanes as edited, all targets' values in one flat array.
+    std::array<std::atomic<float>, ArpModulationPattern::numTargets * ArpModulationPattern::maxLength> modulationValues;
+    std::array<std::atomic<int>, ArpModulationPattern::numTargets> modulationLengths;
+    std::atomic<juce::uint32> modulationVersion{ 1 };
+    juce::uint32 builtModulationVersion = 0;
+
+    ArpTransport getTransport() const;
+    void pushDisplayEvents(bool isPlaying);
+    bool passesThrough(const juce::MidiMessageMetadata& metadata) const;
+    bool passNote(const juce::MidiMessageMetadata& metadata);
+    void updateKeyZones();
+    void updateSidechain();
+    void writeMidiOutput(juce::MidiBuffer& midiMessages);
+    bool isAutomated(Params::Index index) const;
+    void addChange(const ParameterChange& change);
+    void collectSettingsChanges();
+    void applyProgram(const ArpProgram& program);
+    void handleProgramChange(int sampleOffset, int index);
+    void loadProgram(const ArpProgram& program);
+    void setParameters(const ParameterSnapshot& values);
+    void handleAsyncUpdate() override;
     void parameterChanged(const juce::String& parameterID, float newValue) override;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HARPyAudioProcessor)
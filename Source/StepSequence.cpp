@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    StepSequence.cpp
+
+    Precomputed order in which held notes are played.
+
+  ==============================================================================
+*/
+
+#include "StepSequence.h"
+
+#include <cassert>
+#include <utility>
+
+void StepSequence::rebuild(int numNotes, ArpeggioOrder order)
+{
+    assert(numNotes >= 0 && numNotes <= HeldNoteSet::maxNotes);
+
+    builtNumNotes = numNotes;
+    builtOrder = order;
+    length = 0;
+
+    auto append = [this](int index) { indices[length++] = std::uint8_t(index); };
+    auto appendUp = [&](int from, int to) { for (int i = from; i <= to; ++i) append(i); };
+    auto appendDown = [&](int from, int to) { for (int i = from; i >= to; --i) append(i); };
+
+    auto last = numNotes - 1;
+
+    // A single note can't go up and down; it just repeats.
+    if (numNotes <= 1) {
+        appendUp(0, last);
+        return;
+    }
+
+    switch (order) {
+    default:
+    case Up:
+    case Random:
+    case ChordRepeat:
+        appendUp(0, last);
+        break;
+    case Down:
+        appendDown(last, 0);
+        break;
+    case UpDown:
+        appendUp(0, last);
+        appendDown(last - 1, 1);
+        break;
+    case DownUp:
+        appendDown(last, 0);
+        appendUp(1, last - 1);
+        break;
+    case UpAndDown:
+        appendUp(0, last);
+        appendDown(last, 0);
+        break;
+    case DownAndUp:
+        appendDown(last, 0);
+        appendUp(0, last);
+        break;
+    case Converge:
+        for (int low = 0, high = last; low <= high; ++low, --high) {
+            append(low);
+            if (high != low) {
+                append(high);
+            }
+        }
+        break;
+    case Diverge:
+        for (int low = last / 2, high = numNotes / 2; low >= 0; --low, ++high) {
+            append(low);
+            if (high != low) {
+                append(high);
+            }
+        }
+        break;
+    }
+}
+
+void StepSequence::shuffle(std::uint32_t seed, std::int64_t anchor, std::int64_t cycle)
+{
+    assert(builtOrder == Random);
+
+    // Two notes can only avoid repeating across cycles by keeping one order.
+    if (length == 2) {
+        cycle = 0;
+    }
+
+    ArpRandom rng;
+    rng.seed(seed, anchor + cycle * length);
+    permute(rng);
+
+    if (length > 2) {
+        // Fisher-Yates from the end settles the last step with its first
+        // draw, so the previous cycle's last note costs one number. The fix
+        // below never moves the last step, so that number stays the truth.
+        ArpRandom previous;
+        previous.seed(seed, anchor + (cycle - 1) * length);
+        auto previousLast = previous.nextInt(length);
+
+        if (indices[0] == previousLast) {
+            std::swap(indices[0], indices[1 + rng.nextInt(length - 2)]);
+        }
+    }
+}
+
+void StepSequence::permute(ArpRandom& rng)
+{
+    // Fisher-Yates over the ascending table.
+    for (int i = 0; i < length; ++i) {
+        indices[i] = std::uint8_t(i);
+    }
+    for (int i = length - 1; i > 0; --i) {
+        std::swap(indices[i], indices[rng.nextInt(i + 1)]);
+    }
+}
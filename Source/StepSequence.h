@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    StepSequence.h
+
+    Precomputed order in which held notes are played.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ArpRandom.h"
+#include "HeldNoteSet.h"
+
+#include <array>
+#include <cstdint>
+
+enum ArpeggioOrder {
+    Up,
+    Down,
+    UpDown,
+    DownUp,
+    UpAndDown,
+    DownAndUp,
+    Random,
+    ChordRepeat,
+    Converge,
+    Diverge,
+    numArpeggioOrders
+};
+
+//==============================================================================
+/**
+    Flat table of held-note indices, one per step of the arpeggio.
+
+    The table only depends on how many notes are held and on the order, so it
+    is rebuilt lazily when one of those changes; playing a step is then a single
+    lookup. Random reshuffles the table once per cycle, so every held note is
+    played once before any repeats. Chord Repeat doesn't walk the table.
+*/
+class StepSequence {
+public:
+    static constexpr int maxLength = 2 * HeldNoteSet::maxNotes;
+
+    /** Rebuilds the table if the number of held notes or the order changed.
+        Returns true if it was rebuilt. */
+    bool update(int numNotes, ArpeggioOrder order) {
+        if (numNotes != builtNumNotes || order != builtOrder) {
+            rebuild(numNotes, order);
+            return true;
+        }
+        return false;
+    }
+
+    void invalidate() { builtNumNotes = -1; }
+
+    /** Arranges a Random table for one cycle of a pattern that started at
+        grid step anchor. The result only depends on the arguments and the
+        number of notes, so any cycle can be rebuilt on its own; a cycle
+        never starts on the note the previous one ended with. */
+    void shuffle(std::uint32_t seed, std::int64_t anchor, std::int64_t cycle);
+
+    int size() const { return length; }
+    int operator[](int pos) const { return indices[pos]; }
+
+private:
+    void rebuild(int numNotes, ArpeggioOrder order);
+    void permute(ArpRandom& rng);
+
+    std::array<std::uint8_t, maxLength> indices{};
+    int length = 0;
+    int builtNumNotes = -1;
+    ArpeggioOrder builtOrder = Up;
+};
+
+//==============================================================================
+/** Where a pattern stands at a given grid step. */
+struct ArpStep {
+    std::int64_t cycle;  // passes through the pattern since the anchor
+    int position;        // index into the StepSequence
+    bool isPlayed;       // false once Repeats cycles have been played
+};
+
+/**
+    Locates grid step `step` in a pattern of `length` steps that was first
+    played at grid step `anchor`, i.e. the first step after its first key
+    went down. Nothing else goes in, so after a loop or seek the arpeggio
+    carries on exactly where the grid says it should, and any step can be
+    worked out without playing the ones before it. Steps before the anchor
+    (a loop jumped back while keys stay held) continue the pattern
+    backwards.
+*/
+inline ArpStep getArpStep(std::int64_t step, std::int64_t anchor, int length, int repeats)
+{
+    auto sinceAnchor = step - anchor;
+    auto len = std::int64_t(length > 0 ? length : 1);
+
+    // Floored, so the pattern stays in phase on both sides of the anchor.
+    auto cycle = sinceAnchor / len - ((sinceAnchor % len) < 0 ? 1 : 0);
+    auto position = int(sinceAnchor - cycle * len);
+
+    return { cycle, position, repeats <= 0 || cycle < repeats };
+}
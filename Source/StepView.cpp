@@ -0,0 +1,187 @@
+/*
+  ==============================================================================
+
+    StepView.cpp
+
+  ==============================================================================
+*/
+
+#include "StepView.h"
+
+StepView::StepView(ArpDisplayFifo& fifoToDrain) :
+    fifo(fifoToDrain),
+    vblank(this, [this] { update(); })
+{
+    // Whatever piled up while no editor was open is stale.
+    fifo.drain([](const ArpDisplayEvent&) {});
+
+    clearNotes();
+    setOpaque(true);
+}
+
+void StepView::update()
+{
+    auto changed = false;
+    auto lastPpq = ppq;
+
+    fifo.drain([this, &changed](const ArpDisplayEvent& event) {
+        changed |= handle(event);
+    });
+
+    if (changed || (ppq != lastPpq && hasVisibleNotes())) {
+        repaint();
+    }
+}
+
+bool StepView::handle(const ArpDisplayEvent& event)
+{
+    switch (event.type) {
+    case ArpDisplayEvent::Block: {
+        auto changed = event.bpm != bpm || event.isPlaying != isPlaying
+                    || event.stepLength != stepLength || event.gridOrigin != gridOrigin
+                    || event.lastStep != lastStep;
+
+        // A loop or seek leaves nothing on screen that belongs next to the new position.
+        if (event.ppq < ppq - stepLength || event.ppq > ppq + windowQuarters) {
+            clearNotes();
+            changed = true;
+        }
+
+        ppq = event.ppq;
+        bpm = event.bpm;
+        isPlaying = event.isPlaying;
+        stepLength = event.stepLength;
+        gridOrigin = event.gridOrigin;
+        lastStep = event.lastStep;
+        return changed;
+    }
+    case ArpDisplayEvent::NoteOn: {
+        auto channel = (event.channel - 1) & 15;
+        auto note = event.note & 127;
+
+        endNote(channel, note, event.ppq);
+
+        // The oldest note makes room; if it is still held, forget it.
+        auto& slot = notes[std::size_t(nextNote)];
+        if (nextNote < numNotes && slot.end < slot.start) {
+            openNotes[slot.channel][slot.note] = -1;
+        }
+
+        slot = { event.ppq, event.ppq - 1.0, juce::uint8(channel), juce::uint8(note), event.velocity };
+        openNotes[std::size_t(channel)][std::size_t(note)] = juce::int16(nextNote);
+
+        nextNote = (nextNote + 1) % maxNotes;
+        numNotes = juce::jmin(numNotes + 1, maxNotes);
+        return true;
+    }
+    case ArpDisplayEvent::NoteOff:
+        endNote((event.channel - 1) & 15, event.note & 127, event.ppq);
+        return true;
+    case ArpDisplayEvent::AllNotesOff:
+        for (int note = 0; note < 128; ++note) {
+            endNote((event.channel - 1) & 15, note, event.ppq);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void StepView::endNote(int channel, int note, double endPpq)
+{
+    auto& index = openNotes[std::size_t(channel)][std::size_t(note)];
+
+    if (index >= 0) {
+        auto& held = notes[std::size_t(index)];
+        held.end = juce::jmax(held.start, endPpq);
+        index = -1;
+    }
+}
+
+void StepView::clearNotes()
+{
+    for (auto& channel : openNotes) {
+        channel.fill(-1);
+    }
+    numNotes = 0;
+    nextNote = 0;
+}
+
+bool StepView::hasVisibleNotes() const
+{
+    for (int i = 0; i < numNotes; ++i) {
+        const auto& note = notes[std::size_t(i)];
+        if (note.end < note.start || note.end > ppq - windowQuarters) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StepView::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    g.fillAll(Colours::black);
+
+    auto bounds = getLocalBounds().toFloat();
+    auto left = ppq - windowQuarters;
+    auto toX = [&](double position) {
+        return bounds.getX() + float((position - left) / windowQuarters) * bounds.getWidth();
+    };
+
+    // Step grid, unless the steps are too short to tell apart.
+    if (stepLength > 0.0 && windowQuarters / stepLength <= 128.0) {
+        auto getStepPpq = [this](double step) { return gridOrigin + step * stepLength; };
+        auto current = getStepPpq(double(lastStep));
+        g.setColour(Colours::darkgrey.withAlpha(0.5f));
+        g.fillRect(Rectangle<float>::leftTopRightBottom(toX(current), bounds.getY(),
+                                                         toX(current + stepLength), bounds.getBottom()));
+
+        g.setColour(Colours::darkgrey);
+        for (auto step = std::ceil((left - gridOrigin) / stepLength); getStepPpq(step) <= ppq; step += 1.0) {
+            g.drawVerticalLine(roundToInt(toX(getStepPpq(step))), bounds.getY(), bounds.getBottom());
+        }
+    }
+
+    // Fit the pitch range to what is on screen, at least an octave.
+    int lowest = 127;
+    int highest = 0;
+    for (int i = 0; i < numNotes; ++i) {
+        const auto& note = notes[std::size_t(i)];
+        if (note.end < note.start || note.end > left) {
+            lowest = jmin(lowest, int(note.note));
+            highest = jmax(highest, int(note.note));
+        }
+    }
+    if (lowest > highest) {
+        lowest = 60;
+        highest = 60;
+    }
+    auto spare = jmax(0, 12 - (highest - lowest));
+    lowest = jmax(0, lowest - spare / 2);
+    highest = jmin(127, lowest + jmax(12, highest - lowest));
+
+    auto rowHeight = bounds.getHeight() / float(highest - lowest + 1);
+
+    for (int i = 0; i < numNotes; ++i) {
+        const auto& note = notes[std::size_t(i)];
+        auto end = note.end < note.start ? ppq : note.end;
+
+        if (end <= left || note.note < lowest || note.note > highest) {
+            continue;
+        }
+
+        auto r = Rectangle<float>::leftTopRightBottom(toX(note.start), 0.f, jmax(toX(end), toX(note.start) + 2.f), rowHeight);
+        r.setY(bounds.getY() + float(highest - note.note) * rowHeight);
+
+        g.setColour(Colours::white.withAlpha(jmap(note.velocity / 127.f, 0.3f, 1.f)));
+        g.fillRect(r.reduced(0.f, 1.f));
+    }
+
+    g.setColour(Colours::white);
+    g.setFont(12.f);
+    g.drawFittedText(String(bpm, 1) + " BPM" + (isPlaying ? "" : " (free running)")
+                         + "   step " + String(lastStep + 1),
+                     getLocalBounds().reduced(4), Justification::topLeft, 1);
+}
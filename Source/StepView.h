@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    StepView.h
+
+    Scrolling piano roll of the notes the arpeggiator has played.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ArpDisplayFifo.h"
+
+#include <array>
+
+//==============================================================================
+/**
+    Shows the last couple of bars of arpeggiated notes over the step grid,
+    with the current step highlighted and the tempo in the corner.
+
+    Once per display frame it drains the processor's ArpDisplayFifo into a
+    fixed ring of recent notes, so a frame never costs more than one ring's
+    worth of rectangles, and it only repaints when there is something new or
+    something on screen to scroll.
+*/
+class StepView : public juce::Component {
+public:
+    explicit StepView(ArpDisplayFifo& fifo);
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    struct Note {
+        double start;
+        double end;  // < start while the note is still held
+        juce::uint8 channel;
+        juce::uint8 note;
+        juce::uint8 velocity;
+    };
+
+    static constexpr int maxNotes = 256;
+    static constexpr double windowQuarters = 8.0;
+
+    void update();
+    bool handle(const ArpDisplayEvent& event);
+    void endNote(int channel, int note, double ppq);
+    void clearNotes();
+    bool hasVisibleNotes() const;
+
+    ArpDisplayFifo& fifo;
+
+    std::array<Note, maxNotes> notes{};
+    std::array<std::array<juce::int16, 128>, 16> openNotes{};  // index into notes, or -1
+    int numNotes = 0;
+    int nextNote = 0;
+
+    double ppq = 0.0;
+    double stepLength = 1.0;
+    double gridOrigin = 0.0;
+    juce::int64 lastStep = -1;
+    float bpm = 120.f;
+    bool isPlaying = false;
+
+    juce::VBlankAttachment vblank;
+};
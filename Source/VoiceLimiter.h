@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    VoiceLimiter.h
+
+    Bookkeeping for the output notes that are sounding, so that the engine
+    can cap them and pick the one to steal.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+//==============================================================================
+/**
+    The sounding notes, each on two intrusive doubly linked lists: one of
+    all of them in the order they started, and one per velocity. A 128-bit
+    mask says which velocities have notes.
+
+    Adding a note, ending one and finding the one to steal (the oldest, or
+    the oldest of the quietest) are all O(1). Nodes live in a fixed pool,
+    found from (channel, note) through a table, so nothing ever allocates.
+*/
+class VoiceLimiter {
+public:
+    static constexpr int capacity = 128;
+
+    enum StealMode : std::uint8_t {
+        Oldest,
+        Quietest,
+    };
+
+    struct Voice {
+        std::uint8_t channel;  // 1..16
+        std::uint8_t note;
+    };
+
+    VoiceLimiter() { clear(); }
+
+    void clear() {
+        slots.fill(none);
+        lists.fill({ none, none });
+        velocityMask.fill(0);
+        numVoices = 0;
+
+        // Every node starts out on the free list.
+        for (int i = 0; i < capacity; ++i) {
+            nodes[std::size_t(i)].next[byAge] = std::int8_t(i + 1 < capacity ? i + 1 : none);
+        }
+        firstFree = 0;
+    }
+
+    int size() const { return numVoices; }
+    bool isEmpty() const { return numVoices == 0; }
+
+    /** Records a note that has started; it must not be sounding already,
+        and there must be fewer than capacity. */
+    void add(int channel, int note, std::uint8_t velocity) {
+        assert(numVoices < capacity && slots[getKey(channel, note)] == none);
+
+        auto index = firstFree;
+        auto& node = nodes[std::size_t(index)];
+        firstFree = node.next[byAge];
+
+        node.voice = { std::uint8_t(channel), std::uint8_t(note) };
+        node.velocity = std::uint8_t(velocity & 127);
+        slots[getKey(channel, note)] = index;
+
+        append(byAge, ageList(), index);
+        append(byVelocity, velocityList(node.velocity), index);
+        velocityMask[node.velocity >> 6] |= std::uint64_t(1) << (node.velocity & 63);
+        ++numVoices;
+    }
+
+    /** Forgets a note that has ended; does nothing if it wasn't sounding. */
+    void remove(int channel, int note) {
+        auto& slot = slots[getKey(channel, note)];
+        if (slot == none) {
+            return;
+        }
+
+        auto index = slot;
+        auto& node = nodes[std::size_t(index)];
+        slot = none;
+
+        unlink(byAge, ageList(), index);
+        auto& list = velocityList(node.velocity);
+        unlink(byVelocity, list, index);
+        if (list.first == none) {
+            velocityMask[node.velocity >> 6] &= ~(std::uint64_t(1) << (node.velocity & 63));
+        }
+
+        node.next[byAge] = firstFree;
+        firstFree = index;
+        --numVoices;
+    }
+
+    /** The note to steal; there must be at least one. */
+    Voice getVictim(StealMode mode) const {
+        assert(numVoices > 0);
+
+        if (mode == Oldest) {
+            return nodes[std::size_t(lists[0].first)].voice;
+        }
+
+        auto velocity = velocityMask[0] != 0 ? std::countr_zero(velocityMask[0])
+                                             : 64 + std::countr_zero(velocityMask[1]);
+        return nodes[std::size_t(lists[std::size_t(1 + velocity)].first)].voice;
+    }
+
+private:
+    static constexpr std::int8_t none = -1;
+
+    // Each node is on one list of each kind.
+    enum ListKind {
+        byAge,
+        byVelocity,
+    };
+
+    struct List {
+        std::int8_t first;
+        std::int8_t last;
+    };
+
+    struct Node {
+        std::array<std::int8_t, 2> prev;
+        std::array<std::int8_t, 2> next;
+        Voice voice;
+        std::uint8_t velocity;
+    };
+
+    static std::size_t getKey(int channel, int note) { return std::size_t(((channel - 1) & 15) * 128 + (note & 127)); }
+
+    List& ageList() { return lists[0]; }
+    List& velocityList(int velocity) { return lists[std::size_t(1 + velocity)]; }
+
+    void append(ListKind kind, List& list, std::int8_t index) {
+        auto& node = nodes[std::size_t(index)];
+        node.prev[kind] = list.last;
+        node.next[kind] = none;
+
+        if (list.last != none) {
+            nodes[std::size_t(list.last)].next[kind] = index;
+        }
+        else {
+            list.first = index;
+        }
+        list.last = index;
+    }
+
+    void unlink(ListKind kind, List& list, std::int8_t index) {
+        const auto& node = nodes[std::size_t(index)];
+
+        if (node.prev[kind] != none) {
+            nodes[std::size_t(node.prev[kind])].next[kind] = node.next[kind];
+        }
+        else {
+            list.first = node.next[kind];
+        }
+
+        if (node.next[kind] != none) {
+            nodes[std::size_t(node.next[kind])].prev[kind] = node.prev[kind];
+        }
+        else {
+            list.last = node.prev[kind];
+        }
+    }
+
+    std::array<Node, capacity> nodes{};
+    std::array<std::int8_t, 16 * 128> slots{};  // node of each (channel, note)
+    std::array<List, 1 + 128> lists{};           // the age list, then one per velocity
+    std::array<std::uint64_t, 2> velocityMask{};
+    std::int8_t firstFree = 0;
+    int numVoices = 0;
+};
@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    ArpClockTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpClock.h"
+#include "UnitTest.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    struct Bar {
+        double startPpq;
+        int numerator;
+        int denominator;
+    };
+
+    /** Plays the clock from ppq 0 to endPpq at 120 bpm through the given
+        bars, as a host would report them, and returns the ppq of every step. */
+    std::vector<double> getStepPositions(int rate, RateType rateType, const std::vector<Bar>& bars, double endPpq,
+                                         bool hasBarStart = true)
+    {
+        ArpClock clock;
+        clock.prepare(sampleRate);
+        clock.setRate(rate, rateType);
+
+        std::vector<double> steps;
+        auto quartersPerSample = 120.0 / (60.0 * sampleRate);
+
+        for (std::int64_t sample = 0; double(sample) * quartersPerSample < endPpq; sample += blockSize) {
+            ArpTransport transport;
+            transport.isPlaying = true;
+            transport.ppqPosition = double(sample) * quartersPerSample;
+
+            // The bar the block starts in.
+            auto bar = bars.front();
+            for (const auto& b : bars) {
+                if (b.startPpq <= transport.ppqPosition) {
+                    bar = b;
+                }
+            }
+            auto barLength = 4.0 * bar.numerator / bar.denominator;
+            transport.timeSigNumerator = bar.numerator;
+            transport.timeSigDenominator = bar.denominator;
+            transport.hasBarStart = hasBarStart;
+            transport.ppqPositionOfLastBarStart
+                = bar.startPpq + std::floor((transport.ppqPosition - bar.startPpq) / barLength) * barLength;
+
+            clock.beginBlock(transport);
+            while (clock.getNextStepOffset() < blockSize) {
+                steps.push_back(transport.ppqPosition + clock.getNextStepOffset() * quartersPerSample);
+                clock.advanceStep();
+            }
+            clock.endBlock(blockSize);
+        }
+
+        return steps;
+    }
+
+    bool contains(const std::vector<double>& steps, double ppq)
+    {
+        for (auto step : steps) {
+            if (std::abs(step - ppq) < 1.0e-3) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+TEST(arpClockPlacesStepsOnTheGrid)
+{
+    auto steps = getStepPositions(2, Straight, { { 0.0, 4, 4 } }, 8.0);
+
+    EXPECT_EQ(steps.size(), std::size_t(8));
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        EXPECT(std::abs(steps[i] - double(i)) < 1.0e-3);
+    }
+}
+
+TEST(arpClockFollowsBarLinesAcrossTimeSignatures)
+{
+    // Four bars of 4/4, one of 7/8 from ppq 16, then 4/4 again from 19.5.
+    std::vector<Bar> bars{ { 0.0, 4, 4 }, { 16.0, 7, 8 }, { 19.5, 4, 4 } };
+
+    for (auto rate : { 0, 1 }) {
+        auto steps = getStepPositions(rate, Straight, bars, 28.0);
+        EXPECT(contains(steps, 16.0));
+        EXPECT(contains(steps, 19.5));
+        EXPECT(contains(steps, 23.5));
+    }
+
+    // Half-bar triplets put every third step on a bar line.
+    auto triplets = getStepPositions(1, Triplet, bars, 28.0);
+    EXPECT(contains(triplets, 19.5));
+    EXPECT(contains(triplets, 23.5));
+
+    // Without the bar start the grid counts from ppq 0, and the 7/8 bar's
+    // whole-bar steps fall between the bar lines.
+    auto unanchored = getStepPositions(0, Straight, bars, 28.0, false);
+    EXPECT(!contains(unanchored, 19.5));
+}
+
+TEST(arpClockCountsStepsFromTheGridOrigin)
+{
+    ArpClock clock;
+    clock.prepare(sampleRate);
+    clock.setRate(2, Straight);
+
+    // A 3/4 bar at ppq 5 puts the origin at ppq 2, so the quarter-bar step
+    // at ppq 5 is step 4.
+    ArpTransport transport;
+    transport.isPlaying = true;
+    transport.ppqPosition = 5.0;
+    transport.timeSigNumerator = 3;
+    transport.hasBarStart = true;
+    transport.ppqPositionOfLastBarStart = 5.0;
+
+    clock.beginBlock(transport);
+    EXPECT_EQ(clock.getGridOriginPpq(), 2.0);
+    EXPECT_EQ(clock.getNextStepOffset(), 0);
+    EXPECT_EQ(clock.getNextStepIndex(), std::int64_t(4));
+}
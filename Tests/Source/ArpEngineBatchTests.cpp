@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    ArpEngineBatchTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpEngineBatch.h"
+#include "ArpRandom.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+    constexpr double sampleRate = 48000.0;
+    constexpr int numEngines = 24;
+
+    bool isSame(const ArpEventBuffer& a, const ArpEventBuffer& b)
+    {
+        auto isSameEvent = [](const ArpEvent& x, const ArpEvent& y) {
+            return x.offset == y.offset && x.type == y.type && x.channel == y.channel
+                && x.note == y.note && x.velocity == y.velocity;
+        };
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), isSameEvent);
+    }
+
+    ArpeggiatorSettings getSettings(int engine)
+    {
+        ArpeggiatorSettings settings;
+        settings.rate = float(2 + engine % 5);
+        settings.order = ArpeggioOrder(engine % numArpeggioOrders);
+        settings.noteLength = (engine % 3 == 0) ? 0.2f : 0.9f;
+        settings.seed = engine;
+        return settings;
+    }
+}
+
+TEST(arpEngineBatchMatchesEnginesRunAlone)
+{
+    ArpEngineBatch batch;
+    batch.prepare(numEngines, sampleRate, 64, 1024);
+
+    std::vector<ArpEngine> engines(numEngines);
+    std::vector<ArpEventBuffer> inputs(numEngines);
+    std::vector<int> heldNotes(numEngines, -1);
+    ArpEventBuffer output;
+    output.reserve(1024);
+
+    for (int i = 0; i < numEngines; ++i) {
+        engines[std::size_t(i)].prepare(sampleRate);
+        engines[std::size_t(i)].setSettings(getSettings(i));
+        batch.setSettings(i, getSettings(i));
+        inputs[std::size_t(i)].reserve(64);
+    }
+
+    ArpRandom rng;
+    rng.seed(1, 0);
+    ArpTransport transport;
+    transport.isPlaying = true;
+    auto numMismatches = 0;
+    auto numEvents = 0;
+
+    for (int block = 0; block < 3000; ++block) {
+        auto numSamples = 32 + rng.nextInt(480);
+
+        // A tempo change, a meter change and a jump back, part-way through.
+        if (block == 1000) {
+            transport.bpm = 97.0;
+        }
+        if (block == 1500) {
+            transport.timeSigNumerator = 7;
+            transport.timeSigDenominator = 8;
+        }
+        if (block == 2000) {
+            transport.ppqPosition = 3.0;
+        }
+        if (block == 2500) {
+            transport.isPlaying = false;
+        }
+
+        // Each engine holds a note now and then, and sits idle in between.
+        for (int i = 0; i < numEngines; ++i) {
+            auto& held = heldNotes[std::size_t(i)];
+            inputs[std::size_t(i)].clear();
+
+            if (rng.nextInt(held < 0 ? 60 : 20) == 0) {
+                ArpEvent event{ rng.nextInt(numSamples), ArpEvent::NoteOff, 1, std::uint8_t(held), 0 };
+                if (held < 0) {
+                    held = 48 + rng.nextInt(24);
+                    event = { event.offset, ArpEvent::NoteOn, 1, std::uint8_t(held), std::uint8_t(1 + rng.nextInt(127)) };
+                }
+                else {
+                    held = -1;
+                }
+                inputs[std::size_t(i)].add(event);
+                batch.addInput(i, event);
+            }
+        }
+
+        batch.process(transport, numSamples);
+
+        for (int i = 0; i < numEngines; ++i) {
+            output.clear();
+            engines[std::size_t(i)].process(transport, numSamples, inputs[std::size_t(i)], output);
+            numEvents += output.size();
+            numMismatches += isSame(output, batch.getOutput(i)) ? 0 : 1;
+        }
+
+        transport.ppqPosition += numSamples * transport.bpm / (60.0 * sampleRate);
+    }
+
+    EXPECT(numEvents > 1000);
+    EXPECT_EQ(numMismatches, 0);
+}
+
+TEST(arpEngineBatchLeavesIdleEnginesAlone)
+{
+    ArpEngineBatch batch;
+    batch.prepare(2, sampleRate, 8, 64);
+
+    ArpTransport transport;
+    transport.isPlaying = true;
+
+    batch.addInput(0, { 0, ArpEvent::NoteOn, 1, 60, 100 });
+    for (int block = 0; block < 2000; ++block) {
+        batch.process(transport, 256);
+        transport.ppqPosition += 256 * transport.bpm / (60.0 * sampleRate);
+    }
+
+    // The idle engine's clock was never started; the busy one was rendered
+    // for its steps, a bar apart.
+    EXPECT_EQ(batch.getEngine(1).getClock().getBlockStartPpq(), 0.0);
+    EXPECT(batch.getEngine(0).getClock().getBlockStartPpq() > 19.0);
+    EXPECT_EQ(batch.getEngine(0).getNumHeldNotes(), 1);
+}
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    ArpProgramBankTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpProgramBank.h"
+#include "UnitTest.h"
+
+#include <cstring>
+#include <limits>
+
+namespace {
+    juce::MemoryBlock write(const ArpProgramBank& bank, const ArpSessionState& session)
+    {
+        juce::MemoryBlock data;
+        juce::MemoryOutputStream stream(data, false);
+        bank.write(stream, session);
+        stream.flush();
+        return data;
+    }
+
+    bool read(ArpProgramBank& bank, const juce::MemoryBlock& data, ArpSessionState& session)
+    {
+        juce::MemoryInputStream stream(data, false);
+        return bank.read(stream, session);
+    }
+
+    bool isSameBank(const ArpProgramBank& a, const ArpProgramBank& b)
+    {
+        for (int i = 0; i < ArpProgramBank::numPrograms; ++i) {
+            if (a[i].name != b[i].name || a[i].values != b[i].values) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** A bank and a session with something changed in every part. */
+    void makeEdited(ArpProgramBank& bank, ArpSessionState& session)
+    {
+        auto values = ArpProgramBank::getDefaultValues();
+        values[Params::Rate] = 5.f;
+        values[Params::Order] = float(Converge);
+        values[Params::NoteOverlap] = 1.5f;
+        bank[3].setName("Mine");
+        bank[3].setValues(values);
+
+        session.values = values;
+        session.values[Params::Delta] = -7.f;
+        session.program = 3;
+        session.modulation.lengths[ArpModulationPattern::Gate] = 3;
+        session.modulation.values[ArpModulationPattern::Gate][2] = 0.25f;
+    }
+}
+
+TEST(arpProgramBankRoundTripsTheState)
+{
+    ArpProgramBank bank;
+    ArpSessionState session;
+    makeEdited(bank, session);
+    auto data = write(bank, session);
+
+    ArpProgramBank restored;
+    ArpSessionState restoredSession;
+    EXPECT(read(restored, data, restoredSession));
+
+    EXPECT(isSameBank(restored, bank));
+    EXPECT(restored[3].getName() == "Mine");
+    EXPECT_EQ(restored[3].settings.order, Converge);
+    EXPECT(restoredSession.values == session.values);
+    EXPECT_EQ(restoredSession.program, 3);
+    EXPECT(restoredSession.modulation.lengths == session.modulation.lengths);
+    EXPECT(restoredSession.modulation.values == session.modulation.values);
+}
+
+TEST(arpProgramBankLeavesFactoryProgramsOut)
+{
+    ArpProgramBank bank;
+    auto data = write(bank, {});
+
+    // Header, values, no programs, one default step per lane.
+    auto expectedSize = 10 + 4 * Params::numParams + 2 + 2 + ArpModulationPattern::numTargets * 5;
+    EXPECT_EQ(int(data.getSize()), expectedSize);
+
+    ArpProgramBank edited;
+    ArpSessionState session;
+    makeEdited(edited, session);
+    EXPECT(read(edited, data, session));
+    EXPECT(isSameBank(edited, bank));
+}
+
+TEST(arpProgramBankReadsOlderVersions)
+{
+    // Version 1 had no modulation lanes, and this one from a build with
+    // fewer parameters than now.
+    constexpr int numOldValues = Params::NoteOverlap;
+
+    juce::MemoryBlock data;
+    {
+        juce::MemoryOutputStream stream(data, false);
+        stream.writeInt(0x53524168);
+        stream.writeShort(1);
+        stream.writeShort(short(numOldValues));
+        stream.writeShort(2);
+        for (int i = 0; i < numOldValues; ++i) {
+            stream.writeFloat(i == Params::Rate ? 6.f : Params::specs[std::size_t(i)].def);
+        }
+        stream.writeShort(1);
+        stream.writeByte(4);
+        stream.writeByte(3);
+        stream.write("Old", 3);
+        for (int i = 0; i < numOldValues; ++i) {
+            stream.writeFloat(i == Params::NoteLength ? 0.75f : Params::specs[std::size_t(i)].def);
+        }
+    }
+
+    ArpProgramBank bank;
+    ArpSessionState session;
+    session.values[Params::NoteOverlap] = 2.f;
+    EXPECT(read(bank, data, session));
+
+    EXPECT_EQ(session.values[Params::Rate], 6.f);
+    EXPECT_EQ(session.values[Params::NoteOverlap], Params::specs[Params::NoteOverlap].def);
+    EXPECT_EQ(session.program, 2);
+    EXPECT(session.modulation.lengths == ArpModulationPattern::getDefault().lengths);
+    EXPECT(bank[4].getName() == "Old");
+    EXPECT_EQ(bank[4].values[Params::NoteLength], 0.75f);
+    EXPECT_EQ(bank[4].settings.noteLength, 0.75f);
+}
+
+TEST(arpProgramBankRejectsOtherDataUnchanged)
+{
+    ArpProgramBank edited;
+    ArpSessionState editedSession;
+    makeEdited(edited, editedSession);
+    auto data = write(edited, editedSession);
+
+    auto isUntouched = [](const juce::MemoryBlock& bytes) {
+        ArpProgramBank bank;
+        ArpSessionState session;
+        session.program = 9;
+        return !read(bank, bytes, session) && isSameBank(bank, ArpProgramBank()) && session.program == 9;
+    };
+
+    // Cut short anywhere, from a newer format, or not a state at all.
+    for (auto size : { std::size_t(4), std::size_t(20), data.getSize() / 2, data.getSize() - 1 }) {
+        EXPECT(isUntouched(juce::MemoryBlock(data.getData(), size)));
+    }
+
+    auto newer = data;
+    static_cast<char*>(newer.getData())[4] = char(ArpProgramBank::formatVersion + 1);
+    EXPECT(isUntouched(newer));
+
+    auto other = data;
+    static_cast<char*>(other.getData())[0] = 'x';
+    EXPECT(isUntouched(other));
+}
+
+TEST(arpProgramClampsItsValues)
+{
+    auto values = ArpProgramBank::getDefaultValues();
+    values[Params::NoteLength] = 3.f;
+    values[Params::Delta] = -100.f;
+    values[Params::Seed] = std::numeric_limits<float>::quiet_NaN();
+
+    ArpProgram program;
+    program.setValues(values);
+
+    EXPECT_EQ(program.values[Params::NoteLength], 1.f);
+    EXPECT_EQ(program.settings.delta, -24);
+    EXPECT_EQ(program.values[Params::Seed], Params::specs[Params::Seed].def);
+
+    // Names are cut to fit, on a character boundary.
+    program.setName(juce::String::fromUTF8("\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9"
+                                           "\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9"));
+    EXPECT_EQ(int(std::strlen(program.name.data())), 30);
+}
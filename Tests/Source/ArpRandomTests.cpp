@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    ArpRandomTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpRandom.h"
+#include "StepSequence.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+    std::vector<int> getShuffle(int numNotes, std::uint32_t seed, std::int64_t anchor, std::int64_t cycle)
+    {
+        StepSequence sequence;
+        sequence.update(numNotes, Random);
+        sequence.shuffle(seed, anchor, cycle);
+
+        std::vector<int> table;
+        for (int i = 0; i < sequence.size(); ++i) {
+            table.push_back(sequence[i]);
+        }
+        return table;
+    }
+}
+
+TEST(arpRandomRepeatsForTheSameSeedAndPosition)
+{
+    ArpRandom a;
+    ArpRandom b;
+    a.seed(42, 1000);
+    b.seed(42, 1000);
+
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_EQ(a.next(), b.next());
+    }
+
+    b.seed(42, 1001);
+    a.seed(42, 1000);
+    auto differs = false;
+    for (int i = 0; i < 4; ++i) {
+        differs |= a.next() != b.next();
+    }
+    EXPECT(differs);
+}
+
+TEST(arpRandomStaysInRange)
+{
+    ArpRandom rng;
+    rng.seed(7, 0);
+
+    std::vector<int> counts(5, 0);
+    for (int i = 0; i < 5000; ++i) {
+        auto value = rng.nextInt(5);
+        EXPECT(value >= 0 && value < 5);
+        ++counts[std::size_t(std::clamp(value, 0, 4))];
+    }
+
+    for (auto count : counts) {
+        EXPECT(count > 800 && count < 1200);
+    }
+}
+
+TEST(shufflePlaysEveryNoteOncePerCycle)
+{
+    for (std::int64_t cycle = -3; cycle < 20; ++cycle) {
+        auto table = getShuffle(7, 1234, 16, cycle);
+        std::sort(table.begin(), table.end());
+        EXPECT(table == std::vector<int>({ 0, 1, 2, 3, 4, 5, 6 }));
+    }
+}
+
+TEST(shuffleOnlyDependsOnItsArguments)
+{
+    // Any cycle can be rebuilt on its own, e.g. after a loop.
+    auto first = getShuffle(6, 99, 8, 5);
+    getShuffle(6, 99, 8, 4);
+    EXPECT(getShuffle(6, 99, 8, 5) == first);
+    EXPECT(getShuffle(6, 100, 8, 5) != first);
+}
+
+TEST(shuffleNeverRepeatsANoteAcrossCycles)
+{
+    for (int numNotes : { 2, 3, 4, 9 }) {
+        for (std::uint32_t seed = 0; seed < 50; ++seed) {
+            auto previous = getShuffle(numNotes, seed, 0, -1);
+            for (std::int64_t cycle = 0; cycle < 20; ++cycle) {
+                auto table = getShuffle(numNotes, seed, 0, cycle);
+                EXPECT(table.front() != previous.back());
+                previous = table;
+            }
+        }
+    }
+}
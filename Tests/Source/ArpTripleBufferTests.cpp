@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    ArpTripleBufferTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpTripleBuffer.h"
+#include "UnitTest.h"
+
+#include <array>
+#include <thread>
+
+TEST(arpTripleBufferHandsOverTheLatestCopy)
+{
+    ArpTripleBuffer<int> buffer;
+    EXPECT(!buffer.acquire());
+
+    buffer.getBack() = 1;
+    buffer.publish();
+    buffer.getBack() = 2;
+    buffer.publish();
+
+    // Only the newer one arrives, and only once.
+    EXPECT(buffer.acquire());
+    EXPECT_EQ(buffer.getFront(), 2);
+    EXPECT(!buffer.acquire());
+    EXPECT_EQ(buffer.getFront(), 2);
+
+    // The writer never gets the reader's copy back to fill.
+    for (int i = 3; i < 10; ++i) {
+        EXPECT(&buffer.getBack() != &buffer.getFront());
+        buffer.getBack() = i;
+        buffer.publish();
+        EXPECT(buffer.acquire());
+        EXPECT_EQ(buffer.getFront(), i);
+    }
+}
+
+TEST(arpTripleBufferNeverShowsAHalfWrittenCopy)
+{
+    // Every element of a copy holds the same number, so a copy written while
+    // the reader holds it would show up as a mix.
+    using Block = std::array<int, 256>;
+    ArpTripleBuffer<Block> buffer;
+    constexpr int numCopies = 20000;
+
+    std::thread writer([&buffer] {
+        for (int i = 1; i <= numCopies; ++i) {
+            buffer.getBack().fill(i);
+            buffer.publish();
+        }
+    });
+
+    auto last = 0;
+    auto numTorn = 0;
+    auto numBackwards = 0;
+
+    while (last < numCopies) {
+        if (!buffer.acquire()) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const auto& block = buffer.getFront();
+        for (auto value : block) {
+            numTorn += value != block[0] ? 1 : 0;
+        }
+        numBackwards += block[0] <= last ? 1 : 0;
+        last = block[0];
+    }
+
+    writer.join();
+    EXPECT_EQ(numTorn, 0);
+    EXPECT_EQ(numBackwards, 0);
+}
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    HeldNoteSetTests.cpp
+
+  ==============================================================================
+*/
+
+#include "HeldNoteSet.h"
+#include "UnitTest.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace {
+    std::vector<int> getNotes(const HeldNoteSet& set)
+    {
+        std::vector<int> notes;
+        for (int note = 0; note < HeldNoteSet::maxNotes; ++note) {
+            if ((set.getMask()[std::size_t(note >> 6)] >> (note & 63)) & 1) {
+                EXPECT(set.contains(note));
+                notes.push_back(note);
+            }
+        }
+        return notes;
+    }
+}
+
+TEST(heldNoteSetKeepsPitchesInAscendingOrder)
+{
+    HeldNoteSet set;
+    set.add(64, 100);
+    set.add(0, 10);
+    set.add(127, 20);
+    set.add(63, 30);
+
+    EXPECT_EQ(set.size(), 4);
+    EXPECT(getNotes(set) == std::vector<int>({ 0, 63, 64, 127 }));
+    EXPECT_EQ(set.getVelocity(63), 30);
+    EXPECT_EQ(set.getVelocity(127), 20);
+}
+
+TEST(heldNoteSetCountsEachPitchOnce)
+{
+    // C4 held on two channels is one note until both let go.
+    HeldNoteSet set;
+    set.add(60, 100);
+    set.add(60, 80);
+
+    EXPECT_EQ(set.size(), 1);
+    EXPECT_EQ(set.getVelocity(60), 80);
+
+    set.remove(60);
+    EXPECT(set.contains(60));
+    set.remove(60);
+    EXPECT(!set.contains(60));
+    EXPECT(set.isEmpty());
+
+    // A stray release doesn't go negative.
+    set.remove(60);
+    set.add(60, 1);
+    EXPECT_EQ(set.size(), 1);
+}
+
+TEST(heldNoteSetIgnoresPitchesOutOfRange)
+{
+    HeldNoteSet set;
+    set.add(-1, 100);
+    set.add(128, 100);
+    set.remove(-1);
+
+    EXPECT(set.isEmpty());
+    EXPECT(!set.contains(128));
+}
+
+TEST(heldNoteSetMasksEveryPitch)
+{
+    HeldNoteSet set;
+    for (auto note : { 0, 1, 63, 64, 65, 127 }) {
+        set.add(note, std::uint8_t(note + 1));
+    }
+
+    EXPECT(set.getMask()[0] == ((std::uint64_t(1) << 63) | 3));
+    EXPECT(set.getMask()[1] == ((std::uint64_t(1) << 63) | 3));
+    EXPECT_EQ(set.getVelocity(64), 65);
+    EXPECT_EQ(set.getVelocity(127), 128);
+
+    set.remove(63);
+    EXPECT(set.getMask()[0] == 3);
+}
+
+TEST(heldNoteSetForgetsEverythingOnClear)
+{
+    HeldNoteSet set;
+    set.add(70, 100);
+    set.add(50, 100);
+    set.add(50, 60);
+    EXPECT(getNotes(set) == std::vector<int>({ 50, 70 }));
+    EXPECT_EQ(set.getVelocity(50), 60);
+
+    set.clear();
+    EXPECT(set.isEmpty());
+    EXPECT(!set.contains(50));
+    set.add(10, 1);
+    EXPECT(getNotes(set) == std::vector<int>({ 10 }));
+}
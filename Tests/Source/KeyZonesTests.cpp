@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    KeyZonesTests.cpp
+
+  ==============================================================================
+*/
+
+#include "KeyZones.h"
+#include "UnitTest.h"
+
+namespace {
+    KeyZones::Zone makeZone(NoteRoute route, int lowKey, int highKey, int lowVelocity = 1, int highVelocity = 127)
+    {
+        return { true, route, lowKey, highKey, lowVelocity, highVelocity };
+    }
+}
+
+TEST(keyZonesArpeggiateEverythingWhenOff)
+{
+    KeyZones zones;
+    EXPECT(zones.getRoute(60, 100) == NoteRoute::Arpeggiate);
+
+    // A zone that is switched off routes nothing, whatever its ranges.
+    std::array<KeyZones::Zone, KeyZones::maxZones> settings{};
+    settings[0] = makeZone(NoteRoute::PassThrough, 0, 127);
+    settings[0].isEnabled = false;
+    zones.setZones(settings);
+
+    for (int note = 0; note < 128; ++note) {
+        EXPECT(zones.getRoute(note, 100) == NoteRoute::Arpeggiate);
+    }
+}
+
+TEST(keyZonesSplitTheKeyboard)
+{
+    // Bass passes through, the rest is arpeggiated; the ends are inclusive.
+    std::array<KeyZones::Zone, KeyZones::maxZones> settings{};
+    settings[0] = makeZone(NoteRoute::PassThrough, 0, 47);
+    settings[1] = makeZone(NoteRoute::Arpeggiate, 48, 127);
+
+    KeyZones zones;
+    zones.setZones(settings);
+
+    EXPECT(zones.getRoute(0, 100) == NoteRoute::PassThrough);
+    EXPECT(zones.getRoute(47, 100) == NoteRoute::PassThrough);
+    EXPECT(zones.getRoute(48, 100) == NoteRoute::Arpeggiate);
+    EXPECT(zones.getRoute(127, 100) == NoteRoute::Arpeggiate);
+}
+
+TEST(keyZonesCheckVelocityAndLetTheFirstZoneWin)
+{
+    // Soft notes in the middle pass through; zone 3 overlaps but comes
+    // later, so it only takes what zone 2 leaves.
+    std::array<KeyZones::Zone, KeyZones::maxZones> settings{};
+    settings[1] = makeZone(NoteRoute::PassThrough, 60, 72, 1, 63);
+    settings[2] = makeZone(NoteRoute::Arpeggiate, 0, 127, 1, 127);
+    settings[3] = makeZone(NoteRoute::PassThrough, 0, 127, 100, 127);
+
+    KeyZones zones;
+    zones.setZones(settings);
+
+    EXPECT(zones.getRoute(64, 63) == NoteRoute::PassThrough);
+    EXPECT(zones.getRoute(64, 64) == NoteRoute::Arpeggiate);
+    EXPECT(zones.getRoute(59, 10) == NoteRoute::Arpeggiate);
+    EXPECT(zones.getRoute(100, 120) == NoteRoute::Arpeggiate);
+
+    // Without zone 3 in the way, loud notes pass through everywhere.
+    settings[2].isEnabled = false;
+    zones.setZones(settings);
+    EXPECT(zones.getRoute(100, 120) == NoteRoute::PassThrough);
+    EXPECT(zones.getRoute(100, 99) == NoteRoute::Arpeggiate);
+}
+
+TEST(keyZonesClampKeyRanges)
+{
+    std::array<KeyZones::Zone, KeyZones::maxZones> settings{};
+    settings[0] = makeZone(NoteRoute::PassThrough, -10, 200);
+
+    KeyZones zones;
+    zones.setZones(settings);
+    EXPECT(zones.getRoute(0, 1) == NoteRoute::PassThrough);
+    EXPECT(zones.getRoute(127, 127) == NoteRoute::PassThrough);
+
+    // An empty range covers nothing.
+    settings[0] = makeZone(NoteRoute::PassThrough, 70, 60);
+    zones.setZones(settings);
+    EXPECT(zones.getRoute(65, 100) == NoteRoute::Arpeggiate);
+}
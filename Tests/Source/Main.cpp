@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Runs every unit test, or those whose names contain the first argument.
+
+  ==============================================================================
+*/
+
+#include "UnitTest.h"
+
+#include <cstring>
+
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    auto numRun = 0;
+
+    for (const auto& test : UnitTest::getTests()) {
+        if (std::strstr(test.name, filter) == nullptr) {
+            continue;
+        }
+
+        auto failuresBefore = UnitTest::getNumFailures();
+        test.run();
+        std::cout << (UnitTest::getNumFailures() == failuresBefore ? "  ok    " : "  FAIL  ") << test.name << "\n";
+        ++numRun;
+    }
+
+    std::cout << numRun << " tests, " << UnitTest::getNumFailures() << " failed checks\n";
+    return UnitTest::getNumFailures() == 0 ? 0 : 1;
+}
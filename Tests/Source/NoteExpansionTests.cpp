@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    NoteExpansionTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpEngine.h"
+#include "NoteExpansion.h"
+#include "UnitTest.h"
+
+#include <vector>
+
+namespace {
+    std::vector<int> getNotes(const NoteExpansion& expansion, const HeldNoteSet& keys)
+    {
+        std::vector<int> notes;
+        for (int i = 0; i < expansion.size(); ++i) {
+            notes.push_back(expansion.get(keys, i).note);
+        }
+        return notes;
+    }
+
+    HeldNoteSet hold(std::initializer_list<int> notes)
+    {
+        HeldNoteSet keys;
+        for (auto note : notes) {
+            keys.add(note, std::uint8_t(note));
+        }
+        return keys;
+    }
+}
+
+TEST(noteExpansionPlaysEachPitchOnce)
+{
+    // C3 up an octave is C4, which is held already.
+    auto keys = hold({ 48, 60 });
+    NoteExpansion expansion;
+    expansion.update(keys, 12, 1);
+
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 48, 60, 72 }));
+
+    // C4 is its own key, C5 a copy of C4 rather than of C3.
+    EXPECT_EQ(expansion.get(keys, 1).velocity, 60);
+    EXPECT_EQ(expansion.get(keys, 2).velocity, 60);
+}
+
+TEST(noteExpansionInterleavesCopiesOfWideChords)
+{
+    // A chord wider than Delta: the copies fall between the keys.
+    auto keys = hold({ 60, 64, 67 });
+    NoteExpansion expansion;
+    expansion.update(keys, 5, 2);
+
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 60, 64, 65, 67, 69, 70, 72, 74, 77 }));
+    EXPECT_EQ(expansion.get(keys, 2).velocity, 60);
+    EXPECT_EQ(expansion.get(keys, 8).velocity, 67);
+
+    expansion.update(keys, -12, 1);
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 48, 52, 55, 60, 64, 67 }));
+}
+
+TEST(noteExpansionDropsCopiesOutOfRange)
+{
+    auto keys = hold({ 3, 64, 125 });
+    NoteExpansion expansion;
+
+    expansion.update(keys, 62, 2);
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 3, 64, 65, 125, 126, 127 }));
+
+    expansion.update(keys, -64, 8);
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 0, 3, 61, 64, 125 }));
+
+    // No Delta, no copies, whatever Offsets says.
+    expansion.update(keys, 0, 8);
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 3, 64, 125 }));
+
+    expansion.update(keys, 127, 1);
+    EXPECT(getNotes(expansion, keys) == std::vector<int>({ 3, 64, 125 }));
+}
+
+TEST(noteExpansionFollowsTheKeys)
+{
+    auto keys = hold({ 60 });
+    NoteExpansion expansion;
+    expansion.update(keys, 7, 3);
+    EXPECT_EQ(expansion.size(), 4);
+
+    keys.clear();
+    expansion.update(keys, 7, 3);
+    EXPECT(expansion.isEmpty());
+}
+
+TEST(arpEngineArpeggiatesEachExpandedPitchOnce)
+{
+    ArpeggiatorSettings settings;
+    settings.rate = 4.f;
+    settings.delta = 12;
+    settings.offsets = 1;
+
+    ArpEngine engine;
+    engine.prepare(48000.0);
+    engine.setSettings(settings);
+
+    ArpEventBuffer input, output;
+    input.reserve(8);
+    output.reserve(64);
+    input.add({ 0, ArpEvent::NoteOn, 1, 48, 100 });
+    input.add({ 0, ArpEvent::NoteOn, 1, 60, 100 });
+
+    ArpTransport transport;
+    transport.isPlaying = true;
+
+    std::vector<int> played;
+    for (int block = 0; block < 100 && played.size() < 6; ++block) {
+        engine.process(transport, 480, input, output);
+        transport.ppqPosition += 480 / 24000.0;
+        input.clear();
+
+        for (const auto& event : output) {
+            if (event.type == ArpEvent::NoteOn) {
+                played.push_back(event.note);
+            }
+        }
+        output.clear();
+    }
+
+    EXPECT(played == std::vector<int>({ 48, 60, 72, 48, 60, 72 }));
+}
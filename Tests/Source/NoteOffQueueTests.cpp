@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    NoteOffQueueTests.cpp
+
+  ==============================================================================
+*/
+
+#include "ArpEngine.h"
+#include "NoteOffQueue.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+#include <array>
+
+TEST(noteOffQueuePopsInTimeOrder)
+{
+    NoteOffQueue queue;
+    queue.clear();
+
+    const std::int64_t times[] { 500, 20, 7000, 20, 3, 999, 64 };
+    for (int i = 0; i < 7; ++i) {
+        queue.push({ times[i], 1, std::uint8_t(60 + i) });
+    }
+
+    EXPECT_EQ(queue.size(), 7);
+    EXPECT_EQ(queue.top().time, 3);
+
+    std::int64_t last = -1;
+    while (!queue.isEmpty()) {
+        auto entry = queue.pop();
+        EXPECT(entry.time >= last);
+        EXPECT(!queue.contains(entry.channel, entry.note));
+        last = entry.time;
+    }
+    EXPECT_EQ(last, 7000);
+}
+
+TEST(noteOffQueueRemovesNotesAheadOfTime)
+{
+    NoteOffQueue queue;
+    queue.clear();
+
+    for (int i = 0; i < 32; ++i) {
+        queue.push({ (i * 37) % 32, std::uint8_t(1 + i % 2), std::uint8_t(i) });
+    }
+
+    // Channel and note are the key: the same pitch on another channel stays.
+    EXPECT(queue.contains(1, 4));
+    EXPECT(!queue.contains(2, 4));
+    EXPECT(queue.remove(1, 4));
+    EXPECT(!queue.remove(1, 4));
+    EXPECT(queue.remove(2, 31));
+    EXPECT(queue.remove(1, 0));
+    EXPECT_EQ(queue.size(), 29);
+
+    // Whatever was taken from the middle, the rest still come out in order.
+    std::int64_t last = -1;
+    while (!queue.isEmpty()) {
+        auto entry = queue.pop();
+        EXPECT(entry.time >= last);
+        EXPECT(entry.note != 4 && entry.note != 31 && entry.note != 0);
+        last = entry.time;
+    }
+}
+
+TEST(noteOffQueueHoldsItsFullCapacity)
+{
+    NoteOffQueue queue;
+    queue.clear();
+
+    for (int i = 0; i < NoteOffQueue::capacity; ++i) {
+        queue.push({ NoteOffQueue::capacity - i, std::uint8_t(1 + i % 16), std::uint8_t(127 - i / 16) });
+    }
+
+    EXPECT(queue.isFull());
+    EXPECT(queue.contains(1, 127));
+    EXPECT_EQ(queue.pop().time, 1);
+
+    queue.clear();
+    EXPECT(queue.isEmpty());
+    EXPECT(!queue.contains(1, 127));
+}
+
+namespace {
+    struct GateRun {
+        int numNoteOns = 0;
+        int numNoteOffs = 0;
+        int mostSounding = 0;
+    };
+
+    /** Holds C4 and E4 for two bars at 1/8, lets go and plays the gates out. */
+    GateRun runGates(float noteLength, float noteOverlap)
+    {
+        ArpeggiatorSettings settings;
+        settings.rate = 3.f;
+        settings.noteLength = noteLength;
+        settings.noteOverlap = noteOverlap;
+
+        ArpEngine engine;
+        engine.prepare(48000.0);
+        engine.setSettings(settings);
+
+        ArpEventBuffer input, output;
+        input.reserve(8);
+        output.reserve(64);
+
+        ArpTransport transport;
+        transport.isPlaying = true;
+
+        GateRun run;
+        std::array<bool, 128> sounding{};
+        constexpr int blockSize = 500;
+
+        for (int block = 0; block < 1000; ++block) {
+            input.clear();
+            output.clear();
+            if (block == 0) {
+                input.add({ 0, ArpEvent::NoteOn, 1, 60, 100 });
+                input.add({ 0, ArpEvent::NoteOn, 1, 64, 100 });
+            }
+            if (block == 384) {
+                input.add({ 0, ArpEvent::NoteOff, 1, 60, 0 });
+                input.add({ 0, ArpEvent::NoteOff, 1, 64, 0 });
+            }
+
+            engine.process(transport, blockSize, input, output);
+            transport.ppqPosition += blockSize / 24000.0;
+
+            for (const auto& event : output) {
+                if (event.type == ArpEvent::NoteOn) {
+                    ++run.numNoteOns;
+                    sounding[event.note] = true;
+                }
+                else if (event.type == ArpEvent::NoteOff) {
+                    ++run.numNoteOffs;
+                    sounding[event.note] = false;
+                }
+                run.mostSounding = std::max(run.mostSounding, int(std::count(sounding.begin(), sounding.end(), true)));
+            }
+        }
+
+        EXPECT(!engine.hasOpenGates());
+        return run;
+    }
+}
+
+TEST(noteOverlapLetsGatesReachPastTheNextStep)
+{
+    auto separate = runGates(0.5f, 0.f);
+    EXPECT_EQ(separate.numNoteOns, 16);
+    EXPECT_EQ(separate.numNoteOffs, 16);
+    EXPECT_EQ(separate.mostSounding, 1);
+
+    // One and a half steps: each note still sounds when the next one starts.
+    auto overlapping = runGates(0.5f, 1.f);
+    EXPECT_EQ(overlapping.numNoteOns, 16);
+    EXPECT_EQ(overlapping.numNoteOffs, 16);
+    EXPECT_EQ(overlapping.mostSounding, 2);
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    NoteTransformTests.cpp
+
+  ==============================================================================
+*/
+
+#include "NoteTransform.h"
+#include "UnitTest.h"
+
+TEST(noteTransformPassesNotesThroughByDefault)
+{
+    NoteTransform transform;
+    for (int note = 0; note < 128; ++note) {
+        EXPECT_EQ(transform.getNote(note), note);
+    }
+    for (int velocity = 0; velocity < 128; ++velocity) {
+        EXPECT_EQ(int(transform.getVelocity(velocity)), velocity);
+    }
+
+    // Notes pushed further out than the margin are dropped.
+    EXPECT_EQ(transform.getNote(-NoteTransform::inputMargin - 1), NoteStages::noNote);
+    EXPECT_EQ(transform.getNote(127 + NoteTransform::inputMargin + 1), NoteStages::noNote);
+    EXPECT_EQ(transform.getNote(-1), NoteStages::noNote);
+}
+
+TEST(noteTransformQuantisesToTheNearestScaleNote)
+{
+    NoteTransformSettings settings;
+    settings.scale = 1;  // Major
+    settings.key = 2;    // D
+
+    NoteTransform transform;
+    transform.bake(settings);
+
+    // D major: D E F# G A B C#.
+    EXPECT_EQ(transform.getNote(62), 62);
+    EXPECT_EQ(transform.getNote(66), 66);
+    EXPECT_EQ(transform.getNote(65), 64);  // F between E and F#: the lower wins
+    EXPECT_EQ(transform.getNote(60), 59);  // C between B and C#
+    EXPECT_EQ(transform.getNote(63), 62);
+
+    // Transpose comes first, then the scale.
+    settings.transpose = 1;
+    transform.bake(settings);
+    EXPECT_EQ(transform.getNote(64), 64);
+    EXPECT_EQ(transform.getNote(65), 66);
+}
+
+TEST(noteTransformFitsTheRange)
+{
+    NoteTransformSettings settings;
+    settings.lowNote = 60;
+    settings.highNote = 71;
+
+    NoteTransform transform;
+    transform.bake(settings);
+    EXPECT_EQ(transform.getNote(59), NoteStages::noNote);
+    EXPECT_EQ(transform.getNote(60), 60);
+    EXPECT_EQ(transform.getNote(71), 71);
+    EXPECT_EQ(transform.getNote(72), NoteStages::noNote);
+
+    settings.rangeMode = NoteRangeMode::Clamp;
+    transform.bake(settings);
+    EXPECT_EQ(transform.getNote(20), 60);
+    EXPECT_EQ(transform.getNote(100), 71);
+
+    // Folding keeps the pitch class, including for notes from outside 0..127.
+    settings.rangeMode = NoteRangeMode::Fold;
+    transform.bake(settings);
+    EXPECT_EQ(transform.getNote(49), 61);
+    EXPECT_EQ(transform.getNote(100), 64);
+    EXPECT_EQ(transform.getNote(130), 70);
+    EXPECT_EQ(transform.getNote(-5), 67);
+
+    // A range narrower than an octave can miss a pitch class altogether,
+    // and reversed ends are the same range.
+    settings.lowNote = 64;
+    settings.highNote = 60;
+    transform.bake(settings);
+    EXPECT_EQ(transform.getNote(74), 62);
+    EXPECT_EQ(transform.getNote(77), NoteStages::noNote);
+}
+
+TEST(noteTransformCurvesVelocities)
+{
+    NoteTransformSettings settings;
+    settings.velocityCurve = 1.f;
+
+    NoteTransform louder;
+    louder.bake(settings);
+
+    settings.velocityCurve = -1.f;
+    NoteTransform softer;
+    softer.bake(settings);
+
+    // Both ends stay put, the middle moves, and nothing turns into a note-off.
+    for (const auto* transform : { &louder, &softer }) {
+        EXPECT_EQ(int(transform->getVelocity(0)), 0);
+        EXPECT_EQ(int(transform->getVelocity(127)), 127);
+        EXPECT_EQ(int(transform->getVelocity(-5)), 0);
+        EXPECT_EQ(int(transform->getVelocity(200)), 127);
+        for (int velocity = 1; velocity < 128; ++velocity) {
+            EXPECT(transform->getVelocity(velocity) >= 1);
+            EXPECT(transform->getVelocity(velocity) >= transform->getVelocity(velocity - 1));
+        }
+    }
+
+    EXPECT(louder.getVelocity(64) > 64);
+    EXPECT(softer.getVelocity(64) < 64);
+    EXPECT_EQ(int(softer.getVelocity(1)), 1);
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    StepSequenceTests.cpp
+
+  ==============================================================================
+*/
+
+#include "StepSequence.h"
+#include "UnitTest.h"
+
+#include <vector>
+
+namespace {
+    std::vector<int> getTable(int numNotes, ArpeggioOrder order)
+    {
+        StepSequence sequence;
+        sequence.update(numNotes, order);
+
+        std::vector<int> table;
+        for (int i = 0; i < sequence.size(); ++i) {
+            table.push_back(sequence[i]);
+        }
+        return table;
+    }
+
+    using Table = std::vector<int>;
+}
+
+TEST(stepSequenceBuildsEachOrder)
+{
+    EXPECT(getTable(4, Up) == Table({ 0, 1, 2, 3 }));
+    EXPECT(getTable(4, Down) == Table({ 3, 2, 1, 0 }));
+    EXPECT(getTable(4, UpDown) == Table({ 0, 1, 2, 3, 2, 1 }));
+    EXPECT(getTable(4, DownUp) == Table({ 3, 2, 1, 0, 1, 2 }));
+    EXPECT(getTable(4, UpAndDown) == Table({ 0, 1, 2, 3, 3, 2, 1, 0 }));
+    EXPECT(getTable(4, DownAndUp) == Table({ 3, 2, 1, 0, 0, 1, 2, 3 }));
+    EXPECT(getTable(5, Converge) == Table({ 0, 4, 1, 3, 2 }));
+    EXPECT(getTable(5, Diverge) == Table({ 2, 1, 3, 0, 4 }));
+    EXPECT(getTable(4, Diverge) == Table({ 1, 2, 0, 3 }));
+}
+
+TEST(stepSequenceRepeatsASingleNote)
+{
+    EXPECT(getTable(1, UpDown) == Table({ 0 }));
+    EXPECT(getTable(1, Converge) == Table({ 0 }));
+    EXPECT(getTable(0, Up).empty());
+}
+
+TEST(stepSequenceOnlyRebuildsOnChange)
+{
+    StepSequence sequence;
+    EXPECT(sequence.update(3, Up));
+    EXPECT(!sequence.update(3, Up));
+    EXPECT(sequence.update(3, Down));
+    EXPECT(sequence.update(4, Down));
+
+    sequence.invalidate();
+    EXPECT(sequence.update(4, Down));
+}
+
+TEST(stepSequenceHoldsTheLongestPattern)
+{
+    auto table = getTable(HeldNoteSet::maxNotes, UpAndDown);
+    EXPECT_EQ(int(table.size()), StepSequence::maxLength);
+    EXPECT_EQ(table.back(), 0);
+}
+
+TEST(arpStepCountsCyclesFromTheAnchor)
+{
+    auto step = getArpStep(10, 10, 3, 0);
+    EXPECT_EQ(step.cycle, std::int64_t(0));
+    EXPECT_EQ(step.position, 0);
+
+    step = getArpStep(17, 10, 3, 0);
+    EXPECT_EQ(step.cycle, std::int64_t(2));
+    EXPECT_EQ(step.position, 1);
+
+    // Before the anchor the pattern runs on backwards, in phase.
+    step = getArpStep(9, 10, 3, 0);
+    EXPECT_EQ(step.cycle, std::int64_t(-1));
+    EXPECT_EQ(step.position, 2);
+
+    step = getArpStep(7, 10, 3, 0);
+    EXPECT_EQ(step.cycle, std::int64_t(-1));
+    EXPECT_EQ(step.position, 0);
+}
+
+TEST(arpStepStopsAfterRepeats)
+{
+    EXPECT(getArpStep(15, 10, 3, 2).isPlayed);
+    EXPECT(!getArpStep(16, 10, 3, 2).isPlayed);
+    EXPECT(getArpStep(1000, 10, 3, 0).isPlayed);
+
+    // An empty pattern still moves on one step at a time.
+    EXPECT_EQ(getArpStep(12, 10, 0, 0).cycle, std::int64_t(2));
+}
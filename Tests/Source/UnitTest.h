@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    UnitTest.h
+
+    Just enough of a test framework for the engine's unit tests.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+//==============================================================================
+/**
+    Tests register themselves with TEST(name) { ... } and check things with
+    EXPECT(condition) and EXPECT_EQ(actual, expected). A failed check is
+    reported and the test carries on, so one run shows every failure.
+*/
+namespace UnitTest {
+
+struct Test {
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<Test>& getTests()
+{
+    static std::vector<Test> tests;
+    return tests;
+}
+
+inline int& getNumFailures()
+{
+    static int numFailures = 0;
+    return numFailures;
+}
+
+struct Registration {
+    Registration(const char* name, void (*run)()) { getTests().push_back({ name, run }); }
+};
+
+inline void fail(const char* file, int line, const char* what)
+{
+    std::cerr << file << ":" << line << ": failed: " << what << "\n";
+    ++getNumFailures();
+}
+
+template <typename Actual, typename Expected>
+void expectEqual(const Actual& actual, const Expected& expected, const char* file, int line, const char* what)
+{
+    if (!(actual == expected)) {
+        fail(file, line, what);
+        std::cerr << "    got " << +actual << ", expected " << +expected << "\n";
+    }
+}
+
+}
+
+#define TEST(name) \
+    static void name(); \
+    static const UnitTest::Registration name##Registration{ #name, name }; \
+    static void name()
+
+#define EXPECT(condition) \
+    do { if (!(condition)) UnitTest::fail(__FILE__, __LINE__, #condition); } while (false)
+
+#define EXPECT_EQ(actual, expected) \
+    UnitTest::expectEqual((actual), (expected), __FILE__, __LINE__, #actual " == " #expected)
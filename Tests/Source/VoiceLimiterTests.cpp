@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    VoiceLimiterTests.cpp
+
+  ==============================================================================
+*/
+
+#include "UnitTest.h"
+#include "VoiceLimiter.h"
+
+namespace {
+    bool isVoice(VoiceLimiter::Voice voice, int channel, int note)
+    {
+        return voice.channel == channel && voice.note == note;
+    }
+}
+
+TEST(voiceLimiterStealsTheOldest)
+{
+    VoiceLimiter voices;
+    EXPECT(voices.isEmpty());
+
+    voices.add(1, 60, 100);
+    voices.add(1, 64, 20);
+    voices.add(2, 60, 80);
+    EXPECT_EQ(voices.size(), 3);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Oldest), 1, 60));
+
+    // Ending the oldest makes the next one the oldest; ending one that isn't
+    // sounding changes nothing.
+    voices.remove(1, 60);
+    voices.remove(1, 60);
+    voices.remove(3, 60);
+    EXPECT_EQ(voices.size(), 2);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Oldest), 1, 64));
+
+    // A note that starts again goes to the back.
+    voices.add(1, 60, 100);
+    voices.remove(1, 64);
+    voices.add(1, 64, 20);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Oldest), 2, 60));
+}
+
+TEST(voiceLimiterStealsTheOldestOfTheQuietest)
+{
+    VoiceLimiter voices;
+    voices.add(1, 60, 100);
+    voices.add(1, 61, 30);
+    voices.add(1, 62, 90);
+    voices.add(1, 63, 30);
+    voices.add(1, 64, 127);
+
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Quietest), 1, 61));
+    voices.remove(1, 61);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Quietest), 1, 63));
+
+    // Once the last note of a velocity is gone, the next velocity up is found,
+    // across the two halves of the mask too.
+    voices.remove(1, 63);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Quietest), 1, 62));
+    voices.remove(1, 62);
+    voices.remove(1, 60);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Quietest), 1, 64));
+
+    voices.add(16, 0, 0);
+    EXPECT(isVoice(voices.getVictim(VoiceLimiter::Quietest), 16, 0));
+}
+
+TEST(voiceLimiterReusesItsNodes)
+{
+    VoiceLimiter voices;
+
+    // Fill it, empty it in a scrambled order and fill it again, twice over.
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < VoiceLimiter::capacity; ++i) {
+            voices.add(1 + i % 16, i / 16, std::uint8_t(1 + i % 127));
+        }
+        EXPECT_EQ(voices.size(), VoiceLimiter::capacity);
+        EXPECT(isVoice(voices.getVictim(VoiceLimiter::Oldest), 1, 0));
+
+        for (int i = 0; i < VoiceLimiter::capacity; ++i) {
+            auto scrambled = (i * 101) % VoiceLimiter::capacity;
+            voices.remove(1 + scrambled % 16, scrambled / 16);
+        }
+        EXPECT(voices.isEmpty());
+    }
+
+    voices.add(5, 5, 5);
+    voices.clear();
+    EXPECT(voices.isEmpty());
+    voices.add(5, 5, 5);
+    EXPECT_EQ(voices.size(), 1);
+}